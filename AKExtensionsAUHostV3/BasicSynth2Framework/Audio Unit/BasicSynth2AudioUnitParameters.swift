@@ -25,6 +25,18 @@ class BasicSynth2AudioUnitParameters {
 		case filterSustainLevel
 		case filterReleaseDuration
 		case filterEnvelopeStrength
+		case wavetablePosition
+		case wavetableMix
+		case unisonVoices
+		case unisonDetune
+		case unisonStereoSpread
+		case effectSend
+		case delayTime
+		case delayFeedback
+		case delayLevel
+		case reverbSize
+		case reverbDamping
+		case reverbLevel
     }
 
 	var attackDurationAUParameter : AUParameter = {
@@ -254,6 +266,234 @@ class BasicSynth2AudioUnitParameters {
 		return parameter
 	}()
 
+	var wavetablePositionAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "wavetablePosition",
+											name: "Wavetable Position",
+											address: BasicSynth2AUParameters.wavetablePosition.rawValue,
+											min: 0.0,
+											max: 1.0,
+											unit: .generic,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 0.0
+
+		return parameter
+	}()
+
+	var wavetableMixAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "wavetableMix",
+											name: "Wavetable Mix",
+											address: BasicSynth2AUParameters.wavetableMix.rawValue,
+											min: 0.0,
+											max: 1.0,
+											unit: .generic,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 0.0
+
+		return parameter
+	}()
+
+	var unisonVoicesAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "unisonVoices",
+											name: "Unison Voices",
+											address: BasicSynth2AUParameters.unisonVoices.rawValue,
+											min: 1,
+											max: 16,
+											unit: .indexed,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 1
+
+		return parameter
+	}()
+
+	var unisonDetuneAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "unisonDetune",
+											name: "Unison Detune",
+											address: BasicSynth2AUParameters.unisonDetune.rawValue,
+											min: 0.0,
+											max: 100.0,
+											unit: .cents,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 15.0
+
+		return parameter
+	}()
+
+	var unisonStereoSpreadAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "unisonStereoSpread",
+											name: "Unison Stereo Spread",
+											address: BasicSynth2AUParameters.unisonStereoSpread.rawValue,
+											min: 0.0,
+											max: 1.0,
+											unit: .generic,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 0.5
+
+		return parameter
+	}()
+
+	var effectSendAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "effectSend",
+											name: "Effect Send",
+											address: BasicSynth2AUParameters.effectSend.rawValue,
+											min: 0.0,
+											max: 1.0,
+											unit: .generic,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 0.0
+
+		return parameter
+	}()
+
+	var delayTimeAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "delayTime",
+											name: "Delay Time",
+											address: BasicSynth2AUParameters.delayTime.rawValue,
+											min: 0.01,
+											max: 2.0,
+											unit: .seconds,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 0.375
+
+		return parameter
+	}()
+
+	var delayFeedbackAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "delayFeedback",
+											name: "Delay Feedback",
+											address: BasicSynth2AUParameters.delayFeedback.rawValue,
+											min: 0.0,
+											max: 0.95,
+											unit: .generic,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 0.35
+
+		return parameter
+	}()
+
+	var delayLevelAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "delayLevel",
+											name: "Delay Level",
+											address: BasicSynth2AUParameters.delayLevel.rawValue,
+											min: 0.0,
+											max: 1.0,
+											unit: .generic,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 0.5
+
+		return parameter
+	}()
+
+	var reverbSizeAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "reverbSize",
+											name: "Reverb Size",
+											address: BasicSynth2AUParameters.reverbSize.rawValue,
+											min: 0.0,
+											max: 1.0,
+											unit: .generic,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 0.5
+
+		return parameter
+	}()
+
+	var reverbDampingAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "reverbDamping",
+											name: "Reverb Damping",
+											address: BasicSynth2AUParameters.reverbDamping.rawValue,
+											min: 0.0,
+											max: 1.0,
+											unit: .generic,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 0.5
+
+		return parameter
+	}()
+
+	var reverbLevelAUParameter : AUParameter = {
+		let parameter =
+			AUParameterTree.createParameter(withIdentifier: "reverbLevel",
+											name: "Reverb Level",
+											address: BasicSynth2AUParameters.reverbLevel.rawValue,
+											min: 0.0,
+											max: 1.0,
+											unit: .generic,
+											unitName: nil,
+											flags: [.flag_IsReadable,
+													.flag_IsWritable],
+											valueStrings: nil,
+											dependentParameters: nil)
+		// Set default value
+		parameter.value = 0.5
+
+		return parameter
+	}()
+
     let parameterTree: AUParameterTree
 
     init(kernelAdapter: BasicSynth2DSPKernelAdapter) {
@@ -272,6 +512,18 @@ class BasicSynth2AudioUnitParameters {
 			filterSustainLevelAUParameter,
 			filterReleaseDurationAUParameter,
 			filterEnvelopeStrengthAUParameter,
+			wavetablePositionAUParameter,
+			wavetableMixAUParameter,
+			unisonVoicesAUParameter,
+			unisonDetuneAUParameter,
+			unisonStereoSpreadAUParameter,
+			effectSendAUParameter,
+			delayTimeAUParameter,
+			delayFeedbackAUParameter,
+			delayLevelAUParameter,
+			reverbSizeAUParameter,
+			reverbDampingAUParameter,
+			reverbLevelAUParameter,
 		])
 
 
@@ -312,6 +564,30 @@ class BasicSynth2AudioUnitParameters {
 					return String(format: "%.f", value ?? param.value)
 				case BasicSynth2AUParameters.filterEnvelopeStrength.rawValue:
 					return String(format: "%.f", value ?? param.value)
+				case BasicSynth2AUParameters.wavetablePosition.rawValue:
+					return String(format: "%.2f", value ?? param.value)
+				case BasicSynth2AUParameters.wavetableMix.rawValue:
+					return String(format: "%.2f", value ?? param.value)
+				case BasicSynth2AUParameters.unisonVoices.rawValue:
+					return String(format: "%.f", value ?? param.value)
+				case BasicSynth2AUParameters.unisonDetune.rawValue:
+					return String(format: "%.f", value ?? param.value)
+				case BasicSynth2AUParameters.unisonStereoSpread.rawValue:
+					return String(format: "%.2f", value ?? param.value)
+				case BasicSynth2AUParameters.effectSend.rawValue:
+					return String(format: "%.2f", value ?? param.value)
+				case BasicSynth2AUParameters.delayTime.rawValue:
+					return String(format: "%.3f", value ?? param.value)
+				case BasicSynth2AUParameters.delayFeedback.rawValue:
+					return String(format: "%.2f", value ?? param.value)
+				case BasicSynth2AUParameters.delayLevel.rawValue:
+					return String(format: "%.2f", value ?? param.value)
+				case BasicSynth2AUParameters.reverbSize.rawValue:
+					return String(format: "%.2f", value ?? param.value)
+				case BasicSynth2AUParameters.reverbDamping.rawValue:
+					return String(format: "%.2f", value ?? param.value)
+				case BasicSynth2AUParameters.reverbLevel.rawValue:
+					return String(format: "%.2f", value ?? param.value)
 				default:
 					return "?"
 			}
@@ -344,6 +620,30 @@ class BasicSynth2AudioUnitParameters {
 				filterReleaseDurationAUParameter.value = value
 			case .filterEnvelopeStrength:
 				filterEnvelopeStrengthAUParameter.value = value
+			case .wavetablePosition:
+				wavetablePositionAUParameter.value = value
+			case .wavetableMix:
+				wavetableMixAUParameter.value = value
+			case .unisonVoices:
+				unisonVoicesAUParameter.value = value
+			case .unisonDetune:
+				unisonDetuneAUParameter.value = value
+			case .unisonStereoSpread:
+				unisonStereoSpreadAUParameter.value = value
+			case .effectSend:
+				effectSendAUParameter.value = value
+			case .delayTime:
+				delayTimeAUParameter.value = value
+			case .delayFeedback:
+				delayFeedbackAUParameter.value = value
+			case .delayLevel:
+				delayLevelAUParameter.value = value
+			case .reverbSize:
+				reverbSizeAUParameter.value = value
+			case .reverbDamping:
+				reverbDampingAUParameter.value = value
+			case .reverbLevel:
+				reverbLevelAUParameter.value = value
 		}
 	}
 }
@@ -11,7 +11,18 @@
 
 #import <AudioKit/AudioKit.h>
 
+#include <algorithm>
 #include <iostream>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "BasicSynth2Denormals.hpp"
+#include "BasicSynth2Expression.hpp"
+#include "BasicSynth2PresetSnapshot.hpp"
+#include "BasicSynth2SendEffects.hpp"
+#include "BasicSynth2Unison.hpp"
+#include "BasicSynth2Wavetable.hpp"
 
 enum {
 	AttackDurationAddress = 0,
@@ -26,9 +37,23 @@ enum {
 	FilterSustainLevelAddress,
 	FilterReleaseDurationAddress,
 	FilterEnvelopeStrengthAddress,
+	WavetablePositionAddress,
+	WavetableMixAddress,
+	UnisonVoicesAddress,
+	UnisonDetuneAddress,
+	UnisonStereoSpreadAddress,
+	EffectSendAddress,
+	DelayTimeAddress,
+	DelayFeedbackAddress,
+	DelayLevelAddress,
+	ReverbSizeAddress,
+	ReverbDampingAddress,
+	ReverbLevelAddress,
 	NumberOfFilterSynthEnumElements
 };
 
+static_assert((int)NumberOfFilterSynthEnumElements <= (int)kBasicSynth2PresetSnapshotMaxParameters, "Grow the preset snapshot before adding parameters");
+
 /*
  BasicSynth2DSPKernel
  Performs simple copying of the input signal to the output.
@@ -47,17 +72,47 @@ protected:
 	float amp = 0;
 	float filterAmp = 0;
 
+	// Per-channel MPE lanes; the voice follows the lane of the channel its note arrived on.
+	// Pitch bend bends the pitch, pressure narrows the pulse and timbre (CC74) moves the cutoff.
+	BasicSynth2ExpressionLanes expression;
+	int currentChannel = 0;
+
 	sp_data *sp = nullptr;
 	sp_blsquare *blsquare;
 	sp_adsr *adsr;
 	sp_butlp *filter;
+	sp_butlp *filterRight;
 	sp_adsr *filterEnv;
 
 	float width;
 
+	// The wavetable oscillator runs alongside blsquare; WavetableMixAddress crossfades between the two.
+	// Banks are only ever freed from destroy(), when the render thread is no longer reading them.
+	BasicSynth2WavetableOscillator wavetable;
+	std::atomic<BasicSynth2WavetableBank const *> wavetableBank { nullptr };
+	std::vector<std::unique_ptr<BasicSynth2WavetableBank>> wavetableBanks;
+
+	// With more than one unison voice the pulse oscillator becomes a stereo stack,
+	// and filterRight follows filter's cutoff for the right channel.
+	BasicSynth2UnisonOscillator unison;
+
+	// Shared delay and reverb on the summed output. Its buffers are allocated in init().
+	BasicSynth2SendEffects effects;
+
 public:
 	bool resetted = false;
 
+	// When set, a note that starts from silence starts from a freshly initialized voice (oscillator
+	// phases, filter history, envelopes), so it renders the same every time. Offline note caching relies on it.
+	bool resetVoiceOnAttack = false;
+
+	// Render with flush-to-zero on. Only worth turning off to measure what it saves.
+	bool flushDenormals = true;
+
+	// Re-initialize the voice once its release has died away (see clear()). Only worth turning off to let the
+	// envelopes decay into the denormal range, so BasicSynth2TailBenchmark has something to measure.
+	bool turnOffFinishedVoices = true;
+
 	float getSampleRate() { return sampleRate; }
 
 	int currentNoteNumber = 0;
@@ -74,6 +129,18 @@ public:
 	float filterSustainLevel = 1.0;
 	float filterReleaseDuration = 0.1;
 	float filterEnvelopeStrength = 1.0;
+	float wavetablePosition = 0.0;
+	float wavetableMix = 0.0;
+	float unisonVoices = 1.0;
+	float unisonDetune = 15.0;
+	float unisonStereoSpread = 0.5;
+	float effectSend = 0.0;
+	float delayTime = 0.375;
+	float delayFeedback = 0.35;
+	float delayLevel = 0.5;
+	float reverbSize = 0.5;
+	float reverbDamping = 0.5;
+	float reverbLevel = 0.5;
 
 	UInt64 currentRunningIndex = 0;
 
@@ -97,15 +164,31 @@ public:
 	ParameterRamper filterSustainLevelRamper = 1.0;
 	ParameterRamper filterReleaseDurationRamper = 0.1;
 	ParameterRamper filterEnvelopeStrengthRamper = 0.0;
+	ParameterRamper wavetablePositionRamper = 0.0;
+	ParameterRamper wavetableMixRamper = 0.0;
+	ParameterRamper unisonVoicesRamper = 1.0;
+	ParameterRamper unisonDetuneRamper = 15.0;
+	ParameterRamper unisonStereoSpreadRamper = 0.5;
+	ParameterRamper effectSendRamper = 0.0;
+	ParameterRamper delayTimeRamper = 0.375;
+	ParameterRamper delayFeedbackRamper = 0.35;
+	ParameterRamper delayLevelRamper = 0.5;
+	ParameterRamper reverbSizeRamper = 0.5;
+	ParameterRamper reverbDampingRamper = 0.5;
+	ParameterRamper reverbLevelRamper = 0.5;
 
 	AudioBufferList *outBufferListPtr = nullptr;
 
+	// Preset changes published from the UI thread, picked up at the top of the next render cycle.
+	BasicSynth2PresetMailbox presetMailbox;
+
 	BasicSynth2DSPKernel() {
 		std::cout << "BasicSynth2DSPKernel Constructor" << std::endl;
 
 		sp_blsquare_create(&blsquare);
 		sp_adsr_create(&adsr);
 		sp_butlp_create(&filter);
+		sp_butlp_create(&filterRight);
 		sp_adsr_create(&filterEnv);
 
 	};
@@ -118,6 +201,7 @@ public:
 		sp_blsquare_destroy(&blsquare);
 		sp_adsr_destroy(&adsr);
 		sp_butlp_destroy(&filter);
+		sp_butlp_destroy(&filterRight);
 		sp_adsr_destroy(&filterEnv);
 		sp_destroy(&sp);
 	}
@@ -126,7 +210,7 @@ public:
 		std::cout << "BasicSynth2DSPKernel init Called" << std::endl;
 
 		channels = channelCount;
-		sampleRate = sampleRate;
+		this->sampleRate = sampleRate;
 
 		if (sp == nullptr) {
 			std::cout << "SoundPipe init" << std::endl;
@@ -146,6 +230,8 @@ public:
 		sp_adsr_init(this->getSpData(), filterEnv);
 		sp_butlp_init(this->getSpData(), filter);
 		filter->freq = 22050.0;
+		sp_butlp_init(this->getSpData(), filterRight);
+		filterRight->freq = 22050.0;
 
 		attackDurationRamper.init();
 		decayDurationRamper.init();
@@ -159,18 +245,122 @@ public:
 		filterSustainLevelRamper.init();
 		filterReleaseDurationRamper.init();
 		filterEnvelopeStrengthRamper.init();
+		expression.setSmoothingTime(0.005f, (float)sampleRate);
+
+		wavetablePositionRamper.init();
+		wavetableMixRamper.init();
+		unisonVoicesRamper.init();
+		unisonDetuneRamper.init();
+		unisonStereoSpreadRamper.init();
+		effectSendRamper.init();
+		delayTimeRamper.init();
+		delayFeedbackRamper.init();
+		delayLevelRamper.init();
+		reverbSizeRamper.init();
+		reverbDampingRamper.init();
+		reverbLevelRamper.init();
+
+		if (wavetableBanks.empty()) {
+			buildDefaultWavetableBank();
+		}
+		wavetable.reset();
 
+		if (!effects.allocate(sampleRate)) {
+			std::cout << "BasicSynth2DSPKernel could not allocate the effect buffers" << std::endl;
+		}
 	}
 
 	void destroy() {
 		std::cout << "Destorying BasicSynth2DSPKernel" << std::endl;
 		//printf("BasicSynth2DSPKernel.destroy(), &sp is %p\n", (void *)sp);
+
+		// Rendering has stopped, so any bank that has been swapped out can be released now.
+		BasicSynth2WavetableBank const *current = wavetableBank.load(std::memory_order_acquire);
+		wavetableBanks.erase(std::remove_if(wavetableBanks.begin(), wavetableBanks.end(),
+											[current](std::unique_ptr<BasicSynth2WavetableBank> const &bank) {
+												return bank.get() != current;
+											}),
+							 wavetableBanks.end());
+
+		effects.release();
 	}
 
 	void clear() {
 		stage = stageOff;
 		amp = 0;
 		filterAmp = 0;
+		unison.reset();
+
+		// The release has died away, but the envelopes and the filter histories would keep decaying
+		// towards zero for thousands of samples, through the denormal range. Land them on zero now.
+		sp_adsr_init(this->getSpData(), adsr);
+		sp_adsr_init(this->getSpData(), filterEnv);
+		sp_butlp_init(this->getSpData(), filter);
+		sp_butlp_init(this->getSpData(), filterRight);
+	}
+
+	void resetVoice() {
+		clear();
+		sp_blsquare_init(this->getSpData(), blsquare);
+		wavetable.reset();
+	}
+
+	bool isVoiceActive() const {
+		return stage != stageOff;
+	}
+
+	bool hasEffectTail() const {
+		return effects.isActive();
+	}
+
+	// True once every parameter has reached the value it was last set to.
+	bool parametersSettled() {
+		ParameterRamper *rampers[NumberOfFilterSynthEnumElements];
+		collectRampers(rampers);
+		for (ParameterRamper *ramper : rampers) {
+			if (ramper->get() != ramper->getUIValue()) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Fingerprint of everything a note's sound depends on besides note, velocity and gate length:
+	// the current value of every parameter, the sample rate, the wavetable bank and the expression
+	// lane of the channel the note will play on.
+	uint64_t renderStateHash(int channel) {
+		uint64_t hash = 14695981039346656037ull;
+		auto mix = [&hash](void const *bytes, size_t length) {
+			for (size_t i = 0; i < length; ++i) {
+				hash = (hash ^ ((uint8_t const *)bytes)[i]) * 1099511628211ull;
+			}
+		};
+
+		ParameterRamper *rampers[NumberOfFilterSynthEnumElements];
+		collectRampers(rampers);
+		for (ParameterRamper *ramper : rampers) {
+			float const value = ramper->get();
+			mix(&value, sizeof(value));
+		}
+		float const rate = getSampleRate();
+		mix(&rate, sizeof(rate));
+		BasicSynth2WavetableBank const *bank = wavetableBank.load(std::memory_order_acquire);
+		mix(&bank, sizeof(bank));
+
+		int const lane = channel & 0x0F;
+		float const lanes[] = {
+			expression.pitchBend[lane], expression.pitchBendTarget[lane],
+			expression.pressure[lane], expression.pressureTarget[lane],
+			expression.timbre[lane], expression.timbreTarget[lane]
+		};
+		mix(lanes, sizeof(lanes));
+		return hash;
+	}
+
+	// Stands in for rendering frames of silence while the voice is off, for callers that supply
+	// the audio some other way. Only valid while no parameter is ramping.
+	void skipIdleFrames(AUAudioFrameCount frames) {
+		expression.advance((uint32_t)frames, -1);
 	}
 
 	double frequencyScale() {
@@ -199,6 +389,10 @@ public:
 	void noteOn(int noteNumber, int velocity, float frequency) {
 		std::cout << "noteOn() " << std::to_string(noteNumber) + " " + std::to_string(velocity) << std::endl;
 
+		if (resetVoiceOnAttack && velocity != 0 && stage == stageOff) {
+			resetVoice();
+		}
+
 		if (velocity == 0) {
 			// For check for running mode midi off.
 			if (stage == stageOn && currentNoteNumber == noteNumber) {
@@ -226,7 +420,35 @@ public:
 		}
 	}
 
-	void run(int frameCount, float *outL, float *outR) {
+	// MARK: - Render
+
+	// Everything the inner loop needs that is fixed for the whole block.
+	struct RenderBlock {
+		float bentFrequency;
+		float pulseWidth;
+		float filterFrequency;
+		float filterStrength;
+		float wavetableMix;
+		float oscillatorAmp;
+	};
+
+	// Feature flags for the specialized render loops. run() works out which are live once per block.
+	enum RenderFeature : unsigned {
+		RenderPulse = 1 << 0,
+		RenderUnison = 1 << 1,
+		RenderWavetable = 1 << 2,
+		RenderFilterEnvelope = 1 << 3,
+		RenderExpression = 1 << 4,
+		RenderFeatureCount = 1 << 5
+	};
+
+	/*
+	 SampleType only selects the output format: the samples are converted as they are mixed into outL and outR.
+	 The oscillators, envelopes, filter and smoothing state are float (and Soundpipe's SPFLOAT) whatever it is,
+	 so rendering into double buffers costs the same and is no more precise.
+	 */
+	template <typename SampleType>
+	void run(int frameCount, SampleType *outL, SampleType *outR) {
 
 		float originalFrequency = *blsquare->freq;
 		*blsquare->freq *= powf(2, this->pitchBend / 12.0);
@@ -241,9 +463,6 @@ public:
 		adsr->rel = (float)this->releaseDuration;
 
 		float sff = (float)this->filterCutoffFrequency;
-		filter->freq = (float)this->filterCutoffFrequency;
-		float filterStrength = this->filterEnvelopeStrength;
-
 		filter->freq = sff;
 
 		filterEnv->atk = (float)this->filterAttackDuration;
@@ -251,42 +470,181 @@ public:
 		filterEnv->sus = (float)this->filterSustainLevel;
 		filterEnv->rel = (float)this->filterReleaseDuration;
 
-		for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
-			float x = 0;
+		RenderBlock block;
+		block.bentFrequency = bentFrequency;
+		block.pulseWidth = this->pulseWidth;
+		block.filterFrequency = clamp(sff, 0.0f, 22050.0f);
+		block.filterStrength = this->filterEnvelopeStrength;
+		block.wavetableMix = this->wavetableMix;
+		block.oscillatorAmp = *blsquare->amp;
+
+		unsigned features = 0;
+
+		// The unison stack and the wavetable pick up the channel's pitch bend once per block.
+		float oscillatorFrequency = bentFrequency;
+		if (!expression.isNeutral(currentChannel)) {
+			features |= RenderExpression;
+			oscillatorFrequency = clamp(bentFrequency * exp2f(expression.pitchBend[currentChannel] / 12.0f), 0.0f, 22050.0f);
+		}
 
-			*blsquare->freq = bentFrequency;
-			sp_adsr_compute(this->getSpData(), adsr, &internalGate, &amp);
-			sp_blsquare_compute(this->getSpData(), blsquare, nil, &x);
+		if (block.wavetableMix < 1.0f) {
+			int const voices = clamp((int)lrintf(this->unisonVoices), 1, (int)BasicSynth2UnisonOscillator::kMaxVoices);
+			if (voices > 1) {
+				unison.prepare(voices, oscillatorFrequency, getSampleRate(), this->unisonDetune, this->unisonStereoSpread, this->pulseWidth);
+				features |= RenderUnison;
+			} else {
+				features |= RenderPulse;
+			}
+		}
+		if (block.wavetableMix > 0.0f
+			&& wavetable.prepare(wavetableBank.load(std::memory_order_acquire), oscillatorFrequency, getSampleRate(), this->wavetablePosition)) {
+			features |= RenderWavetable;
+		}
+		if (block.filterStrength != 0.0f) {
+			features |= RenderFilterEnvelope;
+		}
 
-			float xf = 0;
+		if (outR == nullptr || outR == outL) {
+			dispatchRender<SampleType, 1, 0>(features, block, frameCount, outL, outL);
+		} else {
+			dispatchRender<SampleType, 2, 0>(features, block, frameCount, outL, outR);
+		}
 
-			float filterFreq = clamp(sff, 0.0f, 22050.0f);
+		expression.advance((uint32_t)frameCount, (features & RenderExpression) ? currentChannel : -1);
+
+		*blsquare->freq = originalFrequency;
 
-			sp_adsr_compute(this->getSpData(), filterEnv, &internalGate, &filterAmp);
+		if (turnOffFinishedVoices && stage == stageRelease && amp < 0.00001) {
+			clear();
+		}
 
-			filterAmp = filterAmp * filterStrength;
-			filter->freq = filterFreq + ((22050.0f - filterFreq) * filterAmp);
+	}
 
-			filter->freq = clamp(filter->freq, 0.0f, 22050.0f);
-			sp_butlp_compute(this->getSpData(), filter, &x, &xf);
+	/*
+	 Walks the feature combinations at compile time and calls the one matching this block,
+	 so each combination gets its own inner loop with the unused branches compiled out.
+	 */
+	template <typename SampleType, int ChannelCount, unsigned Features>
+	typename std::enable_if<(Features < RenderFeatureCount)>::type
+	dispatchRender(unsigned features, RenderBlock const &block, int frameCount, SampleType *outL, SampleType *outR) {
+		if (features == Features) {
+			renderBlock<SampleType, ChannelCount, Features>(block, frameCount, outL, outR);
+		} else {
+			dispatchRender<SampleType, ChannelCount, Features + 1>(features, block, frameCount, outL, outR);
+		}
+	}
 
-			*outL++ += amp * xf;
-			*outR++ += amp * xf;
+	template <typename SampleType, int ChannelCount, unsigned Features>
+	typename std::enable_if<(Features >= RenderFeatureCount)>::type
+	dispatchRender(unsigned, RenderBlock const &, int, SampleType *, SampleType *) {}
+
+	template <typename SampleType, int ChannelCount, unsigned Features>
+	void renderBlock(RenderBlock const &block, int frameCount, SampleType *outL, SampleType *outR) {
+		static_assert(ChannelCount == 1 || ChannelCount == 2, "Mono or stereo only");
+
+		bool const hasPulse = (Features & RenderPulse) != 0;
+		bool const hasUnison = (Features & RenderUnison) != 0;
+		bool const hasWavetable = (Features & RenderWavetable) != 0;
+		bool const hasFilterEnvelope = (Features & RenderFilterEnvelope) != 0;
+		bool const hasExpression = (Features & RenderExpression) != 0;
+		// Unison voices are panned, so a stereo stack needs its own filter on the right channel.
+		bool const stereoFilter = hasUnison && ChannelCount == 2;
+
+		float const mix = block.wavetableMix;
+		float const oscillatorAmp = block.oscillatorAmp;
+		float const filterFreq = block.filterFrequency;
+		float const filterStrength = block.filterStrength;
+
+		if (!hasFilterEnvelope) {
+			filterAmp = 0;
+			filter->freq = filterFreq;
+			filterRight->freq = filterFreq;
 		}
 
-		*blsquare->freq = originalFrequency;
+		int const channel = currentChannel;
+		float bend = expression.pitchBend[channel];
+		float pressure = expression.pressure[channel];
+		float timbre = expression.timbre[channel];
+		float cutoff = filterFreq;
 
-		if (stage == stageRelease && amp < 0.00001) {
-			clear();
+		for (int frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+			float x = 0;
+			float xr = 0;
+
+			*blsquare->freq = block.bentFrequency;
+			if (hasExpression) {
+				expression.smooth(bend, pressure, timbre, channel);
+
+				float const width = clamp(block.pulseWidth * (1.0f - 0.9f * pressure), 0.01f, 0.5f);
+				*blsquare->freq = clamp(block.bentFrequency * exp2f(bend / 12.0f), 0.0f, 22050.0f);
+				*blsquare->width = width;
+				unison.width = width;
+
+				// +/- 2 octaves around the cutoff.
+				cutoff = clamp(filterFreq * exp2f((timbre - 0.5f) * 4.0f), 0.0f, 22050.0f);
+				if (!hasFilterEnvelope) {
+					filter->freq = cutoff;
+				}
+			}
+			sp_adsr_compute(this->getSpData(), adsr, &internalGate, &amp);
+			if (hasUnison) {
+				unison.compute(x, xr);
+				if (ChannelCount == 1) {
+					x = (x + xr) * (float)M_SQRT1_2;
+				}
+				x *= oscillatorAmp;
+				xr *= oscillatorAmp;
+			} else if (hasPulse) {
+				sp_blsquare_compute(this->getSpData(), blsquare, nil, &x);
+			}
+			if (hasWavetable) {
+				float const w = oscillatorAmp * wavetable.compute();
+				x += mix * (w - x);
+				xr += mix * (w - xr);
+			}
+
+			float xf = 0;
+			float xfr = 0;
+
+			// The envelope runs even at zero strength: sp_adsr triggers and releases on changes in the gate,
+			// so skipping it would miss note-ons and note-offs and leave it in the wrong stage.
+			float filterEnvelope = 0;
+			sp_adsr_compute(this->getSpData(), filterEnv, &internalGate, &filterEnvelope);
+			if (hasFilterEnvelope) {
+				filterAmp = filterEnvelope * filterStrength;
+				filter->freq = cutoff + ((22050.0f - cutoff) * filterAmp);
+
+				filter->freq = clamp(filter->freq, 0.0f, 22050.0f);
+			}
+			sp_butlp_compute(this->getSpData(), filter, &x, &xf);
+			if (stereoFilter) {
+				filterRight->freq = filter->freq;
+				sp_butlp_compute(this->getSpData(), filterRight, &xr, &xfr);
+			} else {
+				xfr = xf;
+			}
+
+			*outL++ += (SampleType)(amp * xf);
+			if (ChannelCount == 2) {
+				*outR++ += (SampleType)(amp * xfr);
+			}
 		}
 
+		if (hasExpression) {
+			expression.pitchBend[channel] = bend;
+			expression.pressure[channel] = pressure;
+			expression.timbre[channel] = timbre;
+			*blsquare->width = block.pulseWidth;
+		}
 	}
 
 
 	// Override to handle MIDI events.
 	void handleMIDIEvent(AUMIDIEvent const& midiEvent) {
-		if (midiEvent.length != 3) return;
 		uint8_t status = midiEvent.data[0] & 0xF0;
+		uint8_t channel = midiEvent.data[0] & 0x0F;
+		// Channel pressure is the only two byte message we handle.
+		if (midiEvent.length != 3 && !(midiEvent.length == 2 && status == 0xD0)) return;
 
 		switch (status) {
 			case 0x80 : {
@@ -305,6 +663,10 @@ public:
 				uint8_t note = midiEvent.data[1];
 				uint8_t veloc = midiEvent.data[2];
 				if (note > 127 || veloc > 127) break;
+				if (veloc != 0) {
+					currentChannel = channel;
+					expression.snap(channel);
+				}
 				this->noteOn(note, veloc);
 				break;
 			}
@@ -317,6 +679,18 @@ public:
 
 				std::cout << "CC Received " << std::to_string(cc) + " " + std::to_string(cc_value) << std::endl;
 
+				// MPE timbre
+				if (cc == 74) {
+					expression.setTimbre(channel, cc_value);
+				}
+				break;
+			}
+			case 0xD0 : {
+				expression.setPressure(channel, midiEvent.data[1] & 0x7F);
+				break;
+			}
+			case 0xE0 : {
+				expression.setPitchBend(channel, midiEvent.data[1] & 0x7F, midiEvent.data[2] & 0x7F);
 				break;
 			}
 		}
@@ -336,9 +710,9 @@ public:
 	void process(AUAudioFrameCount frameCount, AUAudioFrameCount bufferOffset) {
 
 		float *outL = (float *)outBufferListPtr->mBuffers[0].mData + bufferOffset;
-		float *outR = (float *)outBufferListPtr->mBuffers[1].mData + bufferOffset;
+		float *outR = outBufferListPtr->mNumberBuffers > 1 ? (float *)outBufferListPtr->mBuffers[1].mData + bufferOffset : nullptr;
 
-		standardFilterSynthGetAndSteps();
+		standardFilterSynthGetAndSteps(frameCount);
 
 		this->run(frameCount, outL, outR);
 
@@ -346,7 +720,17 @@ public:
 
 		for (AUAudioFrameCount i = 0; i < frameCount; ++i) {
 			outL[i] *= .5f;
-			outR[i] *= .5f;
+		}
+		if (outR != nullptr) {
+			for (AUAudioFrameCount i = 0; i < frameCount; ++i) {
+				outR[i] *= .5f;
+			}
+		}
+
+		if (this->effectSend > 0 || effects.isActive()) {
+			effects.prepare(this->effectSend, this->delayTime, this->delayFeedback, this->delayLevel,
+							this->reverbSize, this->reverbDamping, this->reverbLevel);
+			effects.process(outL, outR != nullptr ? outR : outL, frameCount);
 		}
 	}
 
@@ -356,10 +740,16 @@ public:
 	 */
 	void processWithEvents(AudioTimeStamp const *timestamp, AUAudioFrameCount frameCount, AURenderEvent const *events) {
 
+		BasicSynth2DenormalScope denormals(flushDenormals);
+
 		AUEventSampleTime now = AUEventSampleTime(timestamp->mSampleTime);
 		AUAudioFrameCount framesRemaining = frameCount;
 		AURenderEvent const *event = events;
 
+		if (BasicSynth2PresetMailbox::Pending const *pending = presetMailbox.consume()) {
+			applySnapshot(pending->snapshot, pending->rampFrames);
+		}
+
 		while (framesRemaining > 0) {
 			// If there are no more events, we can process the entire remaining segment and exit.
 			if (event == nullptr) {
@@ -391,6 +781,7 @@ public:
 	void reset() {
 
 		resetted = true;
+		effects.clear();
 
 		attackDurationRamper.reset();
 		decayDurationRamper.reset();
@@ -406,6 +797,18 @@ public:
 		filterSustainLevelRamper.reset();
 		filterReleaseDurationRamper.reset();
 		filterEnvelopeStrengthRamper.reset();
+		wavetablePositionRamper.reset();
+		wavetableMixRamper.reset();
+		unisonVoicesRamper.reset();
+		unisonDetuneRamper.reset();
+		unisonStereoSpreadRamper.reset();
+		effectSendRamper.reset();
+		delayTimeRamper.reset();
+		delayFeedbackRamper.reset();
+		delayLevelRamper.reset();
+		reverbSizeRamper.reset();
+		reverbDampingRamper.reset();
+		reverbLevelRamper.reset();
 
 	}
 
@@ -452,6 +855,42 @@ public:
 			case FilterEnvelopeStrengthAddress:
 				filterEnvelopeStrengthRamper.setUIValue(clamp(value, 0.0f, 1.0f));
 				break;
+			case WavetablePositionAddress:
+				wavetablePositionRamper.setUIValue(clamp(value, 0.0f, 1.0f));
+				break;
+			case WavetableMixAddress:
+				wavetableMixRamper.setUIValue(clamp(value, 0.0f, 1.0f));
+				break;
+			case UnisonVoicesAddress:
+				unisonVoicesRamper.setUIValue(clamp(value, 1.0f, 16.0f));
+				break;
+			case UnisonDetuneAddress:
+				unisonDetuneRamper.setUIValue(clamp(value, 0.0f, 100.0f));
+				break;
+			case UnisonStereoSpreadAddress:
+				unisonStereoSpreadRamper.setUIValue(clamp(value, 0.0f, 1.0f));
+				break;
+			case EffectSendAddress:
+				effectSendRamper.setUIValue(clamp(value, 0.0f, 1.0f));
+				break;
+			case DelayTimeAddress:
+				delayTimeRamper.setUIValue(clamp(value, 0.01f, 2.0f));
+				break;
+			case DelayFeedbackAddress:
+				delayFeedbackRamper.setUIValue(clamp(value, 0.0f, 0.95f));
+				break;
+			case DelayLevelAddress:
+				delayLevelRamper.setUIValue(clamp(value, 0.0f, 1.0f));
+				break;
+			case ReverbSizeAddress:
+				reverbSizeRamper.setUIValue(clamp(value, 0.0f, 1.0f));
+				break;
+			case ReverbDampingAddress:
+				reverbDampingRamper.setUIValue(clamp(value, 0.0f, 1.0f));
+				break;
+			case ReverbLevelAddress:
+				reverbLevelRamper.setUIValue(clamp(value, 0.0f, 1.0f));
+				break;
 		}
 	}
 
@@ -482,6 +921,30 @@ public:
 				return filterReleaseDurationRamper.getUIValue();
 			case FilterEnvelopeStrengthAddress:
 				return filterEnvelopeStrengthRamper.getUIValue();
+			case WavetablePositionAddress:
+				return wavetablePositionRamper.getUIValue();
+			case WavetableMixAddress:
+				return wavetableMixRamper.getUIValue();
+			case UnisonVoicesAddress:
+				return unisonVoicesRamper.getUIValue();
+			case UnisonDetuneAddress:
+				return unisonDetuneRamper.getUIValue();
+			case UnisonStereoSpreadAddress:
+				return unisonStereoSpreadRamper.getUIValue();
+			case EffectSendAddress:
+				return effectSendRamper.getUIValue();
+			case DelayTimeAddress:
+				return delayTimeRamper.getUIValue();
+			case DelayFeedbackAddress:
+				return delayFeedbackRamper.getUIValue();
+			case DelayLevelAddress:
+				return delayLevelRamper.getUIValue();
+			case ReverbSizeAddress:
+				return reverbSizeRamper.getUIValue();
+			case ReverbDampingAddress:
+				return reverbDampingRamper.getUIValue();
+			case ReverbLevelAddress:
+				return reverbLevelRamper.getUIValue();
 			default: return 0.0f;
 		}
 	}
@@ -554,19 +1017,99 @@ public:
 		filterEnvelopeStrengthRamper.setImmediate(filterEnvelopeStrength);
 	}
 
-	void standardFilterSynthGetAndSteps() {
-		attackDuration = attackDurationRamper.getAndStep();
-		decayDuration = decayDurationRamper.getAndStep();
-		sustainLevel = sustainLevelRamper.getAndStep();
-		releaseDuration = releaseDurationRamper.getAndStep();
-		pitchBend = double(pitchBendRamper.getAndStep());
-		pulseWidth = double(pulseWidthRamper.getAndStep());
-		filterCutoffFrequency = double(filterCutoffFrequencyRamper.getAndStep());
-		filterAttackDuration = filterAttackDurationRamper.getAndStep();
-		filterDecayDuration = filterDecayDurationRamper.getAndStep();
-		filterSustainLevel = filterSustainLevelRamper.getAndStep();
-		filterReleaseDuration = filterReleaseDurationRamper.getAndStep();
-		filterEnvelopeStrength = filterEnvelopeStrengthRamper.getAndStep();
+	void setWavetablePosition(float value) {
+		wavetablePosition = clamp(value, 0.0f, 1.0f);
+		wavetablePositionRamper.setImmediate(wavetablePosition);
+	}
+
+	void setWavetableMix(float value) {
+		wavetableMix = clamp(value, 0.0f, 1.0f);
+		wavetableMixRamper.setImmediate(wavetableMix);
+	}
+
+	void setUnisonVoices(float value) {
+		unisonVoices = clamp(value, 1.0f, 16.0f);
+		unisonVoicesRamper.setImmediate(unisonVoices);
+	}
+
+	void setUnisonDetune(float value) {
+		unisonDetune = clamp(value, 0.0f, 100.0f);
+		unisonDetuneRamper.setImmediate(unisonDetune);
+	}
+
+	void setUnisonStereoSpread(float value) {
+		unisonStereoSpread = clamp(value, 0.0f, 1.0f);
+		unisonStereoSpreadRamper.setImmediate(unisonStereoSpread);
+	}
+
+	void setEffectSend(float value) {
+		effectSend = clamp(value, 0.0f, 1.0f);
+		effectSendRamper.setImmediate(effectSend);
+	}
+
+	void setDelayTime(float value) {
+		delayTime = clamp(value, 0.01f, 2.0f);
+		delayTimeRamper.setImmediate(delayTime);
+	}
+
+	void setDelayFeedback(float value) {
+		delayFeedback = clamp(value, 0.0f, 0.95f);
+		delayFeedbackRamper.setImmediate(delayFeedback);
+	}
+
+	void setDelayLevel(float value) {
+		delayLevel = clamp(value, 0.0f, 1.0f);
+		delayLevelRamper.setImmediate(delayLevel);
+	}
+
+	void setReverbSize(float value) {
+		reverbSize = clamp(value, 0.0f, 1.0f);
+		reverbSizeRamper.setImmediate(reverbSize);
+	}
+
+	void setReverbDamping(float value) {
+		reverbDamping = clamp(value, 0.0f, 1.0f);
+		reverbDampingRamper.setImmediate(reverbDamping);
+	}
+
+	void setReverbLevel(float value) {
+		reverbLevel = clamp(value, 0.0f, 1.0f);
+		reverbLevelRamper.setImmediate(reverbLevel);
+	}
+
+	// Reads a ramper at the start of a segment and steps it past the whole segment,
+	// so an N-frame ramp takes N frames however the host slices the render calls.
+	static inline float getAndStepBy(ParameterRamper &ramper, AUAudioFrameCount frameCount) {
+		float const value = ramper.get();
+		ramper.stepBy(frameCount);
+		return value;
+	}
+
+	void standardFilterSynthGetAndSteps(AUAudioFrameCount frameCount) {
+		attackDuration = getAndStepBy(attackDurationRamper, frameCount);
+		decayDuration = getAndStepBy(decayDurationRamper, frameCount);
+		sustainLevel = getAndStepBy(sustainLevelRamper, frameCount);
+		releaseDuration = getAndStepBy(releaseDurationRamper, frameCount);
+		pitchBend = double(getAndStepBy(pitchBendRamper, frameCount));
+		pulseWidth = double(getAndStepBy(pulseWidthRamper, frameCount));
+		filterCutoffFrequency = double(getAndStepBy(filterCutoffFrequencyRamper, frameCount));
+		filterAttackDuration = getAndStepBy(filterAttackDurationRamper, frameCount);
+		filterDecayDuration = getAndStepBy(filterDecayDurationRamper, frameCount);
+		filterSustainLevel = getAndStepBy(filterSustainLevelRamper, frameCount);
+		filterReleaseDuration = getAndStepBy(filterReleaseDurationRamper, frameCount);
+		filterEnvelopeStrength = getAndStepBy(filterEnvelopeStrengthRamper, frameCount);
+		wavetablePosition = getAndStepBy(wavetablePositionRamper, frameCount);
+		wavetableMix = getAndStepBy(wavetableMixRamper, frameCount);
+		unisonVoices = getAndStepBy(unisonVoicesRamper, frameCount);
+		unisonDetune = getAndStepBy(unisonDetuneRamper, frameCount);
+		unisonStereoSpread = getAndStepBy(unisonStereoSpreadRamper, frameCount);
+		effectSend = getAndStepBy(effectSendRamper, frameCount);
+		delayTime = getAndStepBy(delayTimeRamper, frameCount);
+		delayFeedback = getAndStepBy(delayFeedbackRamper, frameCount);
+		delayLevel = getAndStepBy(delayLevelRamper, frameCount);
+		reverbSize = getAndStepBy(reverbSizeRamper, frameCount);
+		reverbDamping = getAndStepBy(reverbDampingRamper, frameCount);
+		reverbLevel = getAndStepBy(reverbLevelRamper, frameCount);
 	}
 
 	void startRamp(AUParameterAddress address, AUValue value, AUAudioFrameCount duration) {
@@ -607,6 +1150,111 @@ public:
 			case FilterEnvelopeStrengthAddress:
 				filterEnvelopeStrengthRamper.startRamp(clamp(value, 0.0f, 1.0f), duration);
 				break;
+			case WavetablePositionAddress:
+				wavetablePositionRamper.startRamp(clamp(value, 0.0f, 1.0f), duration);
+				break;
+			case WavetableMixAddress:
+				wavetableMixRamper.startRamp(clamp(value, 0.0f, 1.0f), duration);
+				break;
+			case UnisonVoicesAddress:
+				unisonVoicesRamper.startRamp(clamp(value, 1.0f, 16.0f), duration);
+				break;
+			case UnisonDetuneAddress:
+				unisonDetuneRamper.startRamp(clamp(value, 0.0f, 100.0f), duration);
+				break;
+			case UnisonStereoSpreadAddress:
+				unisonStereoSpreadRamper.startRamp(clamp(value, 0.0f, 1.0f), duration);
+				break;
+			case EffectSendAddress:
+				effectSendRamper.startRamp(clamp(value, 0.0f, 1.0f), duration);
+				break;
+			case DelayTimeAddress:
+				delayTimeRamper.startRamp(clamp(value, 0.01f, 2.0f), duration);
+				break;
+			case DelayFeedbackAddress:
+				delayFeedbackRamper.startRamp(clamp(value, 0.0f, 0.95f), duration);
+				break;
+			case DelayLevelAddress:
+				delayLevelRamper.startRamp(clamp(value, 0.0f, 1.0f), duration);
+				break;
+			case ReverbSizeAddress:
+				reverbSizeRamper.startRamp(clamp(value, 0.0f, 1.0f), duration);
+				break;
+			case ReverbDampingAddress:
+				reverbDampingRamper.startRamp(clamp(value, 0.0f, 1.0f), duration);
+				break;
+			case ReverbLevelAddress:
+				reverbLevelRamper.startRamp(clamp(value, 0.0f, 1.0f), duration);
+				break;
+		}
+	}
+
+	// MARK: - Wavetables
+
+	// UI thread. Maps a bank from disk; the render thread picks it up on its next cycle.
+	bool loadWavetableBank(char const *path) {
+		std::unique_ptr<BasicSynth2WavetableBank> bank(new BasicSynth2WavetableBank());
+		if (!bank->open(path)) {
+			return false;
+		}
+		wavetableBank.store(bank.get(), std::memory_order_release);
+		wavetableBanks.push_back(std::move(bank));
+		return true;
+	}
+
+	// Sine -> triangle -> saw -> square, so the position parameter does something before a bank is loaded.
+	void buildDefaultWavetableBank() {
+		enum { frames = 4, harmonicCount = 1024, tableLength = 2048, octaves = 10 };
+
+		std::vector<float> harmonics(frames * harmonicCount, 0.0f);
+		float *sine = &harmonics[0];
+		float *triangle = &harmonics[harmonicCount];
+		float *saw = &harmonics[2 * harmonicCount];
+		float *square = &harmonics[3 * harmonicCount];
+
+		sine[0] = 1.0f;
+		for (int harmonic = 1; harmonic <= harmonicCount; ++harmonic) {
+			bool const odd = (harmonic % 2) == 1;
+			if (odd) {
+				triangle[harmonic - 1] = (((harmonic - 1) / 2) % 2 == 0 ? 1.0f : -1.0f) / (float)(harmonic * harmonic);
+				square[harmonic - 1] = 1.0f / (float)harmonic;
+			}
+			saw[harmonic - 1] = 1.0f / (float)harmonic;
+		}
+
+		std::unique_ptr<BasicSynth2WavetableBank> bank(new BasicSynth2WavetableBank());
+		if (!bank->build(harmonics.data(), harmonicCount, frames, tableLength, octaves)) {
+			return;
+		}
+		wavetableBank.store(bank.get(), std::memory_order_release);
+		wavetableBanks.push_back(std::move(bank));
+	}
+
+	// MARK: - Preset Snapshots
+
+	// UI thread. Captures the UI-side value of every parameter.
+	void captureSnapshot(BasicSynth2PresetSnapshot &snapshot) {
+		snapshot = BasicSynth2PresetSnapshot();
+		snapshot.parameterCount = NumberOfFilterSynthEnumElements;
+		for (AUParameterAddress address = 0; address < NumberOfFilterSynthEnumElements; ++address) {
+			snapshot.values[address] = getParameter(address);
+		}
+	}
+
+	// UI thread. The whole preset lands on the render thread in one go, instead of one setParameter per address.
+	bool publishSnapshot(BasicSynth2PresetSnapshot const &snapshot, AUAudioFrameCount rampFrames) {
+		if (!snapshot.isValid()) {
+			return false;
+		}
+		presetMailbox.publish(snapshot, rampFrames);
+		return true;
+	}
+
+	// Render thread. Ramps every parameter the snapshot knows about to its new value over rampFrames.
+	void applySnapshot(BasicSynth2PresetSnapshot const &snapshot, AUAudioFrameCount rampFrames) {
+		AUParameterAddress const count = std::min<AUParameterAddress>(snapshot.parameterCount, NumberOfFilterSynthEnumElements);
+		for (AUParameterAddress address = 0; address < count; ++address) {
+			startRamp(address, snapshot.values[address], rampFrames);
 		}
 	}
 
@@ -623,6 +1271,22 @@ private:
 
 	AUAudioFrameCount maxFramesToRender = 512;
 
+	// Every ramper, in parameter address order.
+	void collectRampers(ParameterRamper *rampers[NumberOfFilterSynthEnumElements]) {
+		ParameterRamper *const all[] = {
+			&attackDurationRamper, &decayDurationRamper, &sustainLevelRamper, &releaseDurationRamper,
+			&pitchBendRamper, &pulseWidthRamper, &filterCutoffFrequencyRamper,
+			&filterAttackDurationRamper, &filterDecayDurationRamper, &filterSustainLevelRamper,
+			&filterReleaseDurationRamper, &filterEnvelopeStrengthRamper,
+			&wavetablePositionRamper, &wavetableMixRamper,
+			&unisonVoicesRamper, &unisonDetuneRamper, &unisonStereoSpreadRamper,
+			&effectSendRamper, &delayTimeRamper, &delayFeedbackRamper, &delayLevelRamper,
+			&reverbSizeRamper, &reverbDampingRamper, &reverbLevelRamper
+		};
+		static_assert(sizeof(all) / sizeof(all[0]) == NumberOfFilterSynthEnumElements, "Add new parameters here too");
+		std::copy(std::begin(all), std::end(all), rampers);
+	}
+
 	void handleOneEvent(AURenderEvent const *event) {
 		switch (event->head.eventType) {
 			case AURenderEventParameter:
@@ -655,6 +1319,10 @@ private:
 
 };
 
+// The adapter holds the kernel as an Objective-C ivar and the harness and render server allocate it with new,
+// none of which promise more than 16 bytes of alignment under gnu++14. Keep member alignment within that.
+static_assert(alignof(BasicSynth2DSPKernel) <= 16, "BasicSynth2DSPKernel must not be over-aligned");
+
 
 
 class BasicSynth2ParametricKernel {
@@ -0,0 +1,77 @@
+//
+//  BasicSynth2Denormals.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2Denormals_hpp
+#define BasicSynth2Denormals_hpp
+
+#include <cstdint>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#endif
+
+// MARK: - BasicSynth2DenormalScope
+/*
+ BasicSynth2DenormalScope
+
+ Puts the calling thread's floating point unit into flush-to-zero (and, on x86, denormals-are-zero)
+ mode for the lifetime of the object, then restores whatever mode the caller had. Denormal arithmetic
+ takes a slow path on x86 that can cost a hundred cycles per operation, and decaying filter and
+ envelope state hits it at the end of every release.
+
+ The host owns the render thread's floating point state, so it is only changed for the render call.
+ */
+class BasicSynth2DenormalScope {
+public:
+	explicit BasicSynth2DenormalScope(bool enabled = true) {
+		if (!enabled) {
+			return;
+		}
+		saved = read();
+		write(saved | kFlushBits);
+		active = true;
+	}
+
+	~BasicSynth2DenormalScope() {
+		if (active) {
+			write(saved);
+		}
+	}
+
+	BasicSynth2DenormalScope(BasicSynth2DenormalScope const&) = delete;
+	BasicSynth2DenormalScope& operator=(BasicSynth2DenormalScope const&) = delete;
+
+	// The calling thread's floating point control register (MXCSR or FPCR), and the bits the scope sets in it.
+#if defined(__SSE__) || defined(__x86_64__)
+	// MXCSR flush-to-zero (bit 15) and denormals-are-zero (bit 6).
+	static constexpr uint64_t kFlushBits = 0x8040;
+
+	static uint64_t read() { return _mm_getcsr(); }
+	static void write(uint64_t state) { _mm_setcsr((unsigned int)state); }
+#elif defined(__aarch64__)
+	// FPCR FZ (bit 24) flushes denormal inputs and results alike.
+	static constexpr uint64_t kFlushBits = 1ull << 24;
+
+	static uint64_t read() {
+		uint64_t state;
+		__asm__ __volatile__("mrs %0, fpcr" : "=r"(state));
+		return state;
+	}
+	static void write(uint64_t state) { __asm__ __volatile__("msr fpcr, %0" : : "r"(state)); }
+#else
+	static constexpr uint64_t kFlushBits = 0;
+
+	static uint64_t read() { return 0; }
+	static void write(uint64_t) {}
+#endif
+
+private:
+	uint64_t saved = 0;
+	bool active = false;
+};
+
+#endif /* BasicSynth2Denormals_hpp */
@@ -0,0 +1,125 @@
+//
+//  BasicSynth2Expression.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2Expression_hpp
+#define BasicSynth2Expression_hpp
+
+#include <cmath>
+#include <cstdint>
+
+// MARK: - BasicSynth2ExpressionLanes
+/*
+ BasicSynth2ExpressionLanes
+
+ MIDI Polyphonic Expression state: pitch bend, pressure and timbre (CC74) for each of the 16 channels.
+ Under MPE every sounding note gets its own channel, so a note's channel is its modulation lane.
+
+ Lanes are stored structure-of-arrays. Incoming controller messages only overwrite a target,
+ so a dense controller stream costs one store per message; the smoothing towards the targets
+ happens in advance(), once per render segment, as one branch-free pass over all 16 lanes.
+ The lane a note is playing on is smoothed per sample by the render loop instead (see smooth()).
+ */
+struct BasicSynth2ExpressionLanes {
+	// Channel 1 is the lower zone's master channel under MPE, and the channel an ordinary keyboard plays on.
+	enum { kChannels = 16, kMasterChannel = 0 };
+
+	// Current (smoothed) values, read by the render loop.
+	alignas(16) float pitchBend[kChannels];		// semitones
+	alignas(16) float pressure[kChannels];		// 0...1
+	alignas(16) float timbre[kChannels];		// 0...1, 0.5 is neutral
+
+	// Latest values received over MIDI.
+	alignas(16) float pitchBendTarget[kChannels];
+	alignas(16) float pressureTarget[kChannels];
+	alignas(16) float timbreTarget[kChannels];
+
+	// Pitch bend ranges in semitones, at MPE's defaults: member channels bend +/- 48, the master
+	// channel +/- 2, which is also what a non-MPE keyboard's pitch wheel expects.
+	float memberPitchBendRange = 48.0f;
+	float masterPitchBendRange = 2.0f;
+
+	// One-pole smoothing coefficient per sample, from setSmoothingTime().
+	float coefficient = 1.0f;
+
+	BasicSynth2ExpressionLanes() {
+		reset();
+	}
+
+	void reset() {
+		for (int channel = 0; channel < kChannels; ++channel) {
+			pitchBend[channel] = pitchBendTarget[channel] = 0.0f;
+			pressure[channel] = pressureTarget[channel] = 0.0f;
+			timbre[channel] = timbreTarget[channel] = 0.5f;
+		}
+	}
+
+	void setSmoothingTime(float seconds, float sampleRate) {
+		coefficient = (seconds > 0 && sampleRate > 0) ? 1.0f - expf(-1.0f / (seconds * sampleRate)) : 1.0f;
+	}
+
+	// MARK: MIDI
+
+	void setPitchBend(uint8_t channel, uint8_t lsb, uint8_t msb) {
+		int const value = ((int)msb << 7) | (int)lsb;
+		int const lane = channel & 0x0F;
+		float const range = lane == kMasterChannel ? masterPitchBendRange : memberPitchBendRange;
+		pitchBendTarget[lane] = (float)(value - 8192) / 8192.0f * range;
+	}
+
+	void setPressure(uint8_t channel, uint8_t value) {
+		pressureTarget[channel & 0x0F] = (float)value / 127.0f;
+	}
+
+	// CC74 rests at 64, which must come out as exactly 0.5 for the lane to count as neutral again.
+	void setTimbre(uint8_t channel, uint8_t value) {
+		timbreTarget[channel & 0x0F] = value <= 64 ? (float)value / 128.0f : 0.5f + (float)(value - 64) / 126.0f;
+	}
+
+	// A new note starts from whatever expression its channel already has, without gliding into it.
+	void snap(int channel) {
+		pitchBend[channel] = pitchBendTarget[channel];
+		pressure[channel] = pressureTarget[channel];
+		timbre[channel] = timbreTarget[channel];
+	}
+
+	bool isNeutral(int channel) const {
+		return pitchBend[channel] == 0.0f && pitchBendTarget[channel] == 0.0f
+			&& pressure[channel] == 0.0f && pressureTarget[channel] == 0.0f
+			&& timbre[channel] == 0.5f && timbreTarget[channel] == 0.5f;
+	}
+
+	// MARK: Smoothing
+
+	// Per-sample step for a single lane, used by the render loop for the lane that is sounding.
+	inline void smooth(float &bend, float &press, float &tone, int channel) const {
+		bend += coefficient * (pitchBendTarget[channel] - bend);
+		press += coefficient * (pressureTarget[channel] - press);
+		tone += coefficient * (timbreTarget[channel] - tone);
+	}
+
+	// Moves every lane except skipChannel frames samples closer to its target, in closed form.
+	// Lanes that are close enough land exactly on their target, so isNeutral() can become true again.
+	// That includes skipChannel: smooth() can stall a few ULPs short of the target, where the coefficient
+	// times the distance rounds away, and it is snapped here after the render loop has stored it back.
+	void advance(uint32_t frames, int skipChannel) {
+		float const decay = powf(1.0f - coefficient, (float)frames);
+		for (int channel = 0; channel < kChannels; ++channel) {
+			float const keep = channel == skipChannel ? 1.0f : decay;
+			pitchBend[channel] = settle(pitchBend[channel], pitchBendTarget[channel], keep);
+			pressure[channel] = settle(pressure[channel], pressureTarget[channel], keep);
+			timbre[channel] = settle(timbre[channel], timbreTarget[channel], keep);
+		}
+	}
+
+private:
+	static inline float settle(float current, float target, float keep) {
+		float const distance = (current - target) * keep;
+		return target + (fabsf(distance) < 1.0e-5f ? 0.0f : distance);
+	}
+};
+
+#endif /* BasicSynth2Expression_hpp */
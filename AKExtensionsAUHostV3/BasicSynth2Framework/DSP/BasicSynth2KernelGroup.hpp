@@ -0,0 +1,621 @@
+//
+//  BasicSynth2KernelGroup.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2KernelGroup_hpp
+#define BasicSynth2KernelGroup_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "BasicSynth2Denormals.hpp"
+#include "BasicSynth2DSPKernel.hpp"
+#include "BasicSynth2Unison.hpp"
+
+// MARK: - BasicSynth2KernelGroup
+/*
+ BasicSynth2KernelGroup
+
+ Many instances of the core BasicSynth2 voice (pulse oscillator -> lowpass filter with its own envelope ->
+ amplitude envelope, driven by the first FilterEnvelopeStrengthAddress + 1 parameters), rendered together.
+
+ A standalone BasicSynth2DSPKernel keeps each instance's state in one large object plus half a dozen separate
+ Soundpipe allocations, so rendering hundreds of them walks hundreds of scattered heap blocks every cycle.
+ Here the render state of every instance lives in one aligned arena, structure-of-arrays with one lane per
+ instance, laid out in the order the render loop touches it:
+
+	per sample, read and written		oscillator phase, envelope levels and stages, filter history
+	per sample, read only				phase increment, pulse width, envelope rates, filter coefficients
+	per block							parameter ramps (value, target, step, frames left)
+
+ and render() makes one pass over it, kLaneWidth instances at a time with the lanes as the inner loop,
+ so the per-sample work vectorizes across instances.
+
+ Two threads use a group. The control thread adds and removes instances, sets parameters and plays notes;
+ those calls only update the control side's ColdInstance array (what getParameter() reads) and queue a
+ command. The render thread owns the arena: render() applies the queued commands, in order, before it
+ renders anything. The queue is single producer, single consumer and lock free, so the control calls must
+ come from one thread at a time, and they return false when the queue is full. allocate() and release()
+ must not overlap render().
+
+ Compared to the standalone kernel: events take effect at the start of the next render() call, a render call
+ uses where its parameter ramps end up rather than where they start, the filter coefficients follow the
+ filter envelope every kControlInterval frames rather than every frame, and the envelopes are this file's own
+ one-pole segments timed like sp_adsr's. So output is close to but not the same as the kernel's;
+ BasicSynth2RegressionHarness::runGroupComparison() checks how close. Unison, wavetables, MPE and the
+ effect bus stay standalone-kernel features.
+ */
+class BasicSynth2KernelGroup {
+public:
+	enum {
+		kLaneWidth = 8,
+		kControlInterval = 16,
+		kAlignment = 64,
+		kParameterCount = FilterEnvelopeStrengthAddress + 1,
+		kCommandCapacity = 1024
+	};
+
+	struct ColdInstance {
+		bool inUse = false;
+		float values[kParameterCount] = {};
+	};
+
+	struct MemoryReport {
+		uint32_t capacity = 0;
+		uint32_t instances = 0;
+		size_t hotBytesPerInstance = 0;
+		size_t coldBytesPerInstance = 0;
+		size_t totalBytes = 0;
+		// A standalone BasicSynth2DSPKernel and its Soundpipe structs. sizeof(sp_blsquare) leaves out the
+		// oscillator state sp_blsquare_init allocates separately, and the kernel's wavetable banks and
+		// effect buffers aren't counted either.
+		size_t standaloneKernelBytes = 0;
+	};
+
+	bool flushDenormals = true;
+
+	BasicSynth2KernelGroup() = default;
+	BasicSynth2KernelGroup(BasicSynth2KernelGroup const&) = delete;
+	BasicSynth2KernelGroup& operator=(BasicSynth2KernelGroup const&) = delete;
+
+	~BasicSynth2KernelGroup() {
+		release();
+	}
+
+	// Not real-time safe: call it at allocateRenderResources time, never while render() may be running.
+	bool allocate(uint32_t instanceCapacity, double rate) {
+		release();
+		if (instanceCapacity == 0 || rate <= 0) {
+			return false;
+		}
+
+		capacity = instanceCapacity;
+		stride = (capacity + kLaneWidth - 1) / kLaneWidth * kLaneWidth;
+		stride = (stride * sizeof(float) + kAlignment - 1) / kAlignment * kAlignment / sizeof(float);
+		sampleRate = (float)rate;
+
+		void *memory = nullptr;
+		if (posix_memalign(&memory, kAlignment, arenaFloats() * sizeof(float)) != 0) {
+			capacity = 0;
+			return false;
+		}
+		arena = (float *)memory;
+		memset(arena, 0, arenaFloats() * sizeof(float));
+		cold.assign(capacity, ColdInstance());
+		laneInUse.assign(capacity, 0);
+		commands.assign(kCommandCapacity, Command());
+		commandsWritten.store(0, std::memory_order_relaxed);
+		commandsRead.store(0, std::memory_order_relaxed);
+
+		// Unused lanes run silently at a harmless rate.
+		for (uint32_t lane = 0; lane < stride; ++lane) {
+			resetLane(lane);
+		}
+		return true;
+	}
+
+	void release() {
+		free(arena);
+		arena = nullptr;
+		cold.clear();
+		laneInUse.clear();
+		commands.clear();
+		capacity = 0;
+		stride = 0;
+		instanceCount = 0;
+		liveInstances = 0;
+	}
+
+	// Control thread. Returns the new instance's index, or -1 when the group or the command queue is full.
+	int addInstance() {
+		for (uint32_t index = 0; index < capacity; ++index) {
+			if (cold[index].inUse) {
+				continue;
+			}
+			if (!push(Command::AddInstance, index)) {
+				return -1;
+			}
+			cold[index] = ColdInstance();
+			cold[index].inUse = true;
+			for (int address = 0; address < kParameterCount; ++address) {
+				cold[index].values[address] = defaultValue(address);
+			}
+			++liveInstances;
+			return (int)index;
+		}
+		return -1;
+	}
+
+	// Control thread.
+	bool removeInstance(int index) {
+		if (!isInstance(index) || !push(Command::RemoveInstance, (uint32_t)index)) {
+			return false;
+		}
+		cold[index].inUse = false;
+		--liveInstances;
+		return true;
+	}
+
+	// Control thread.
+	uint32_t getInstanceCount() const { return liveInstances; }
+
+	// MARK: Parameters
+
+	// Control thread. Takes effect at the start of the next render() call.
+	bool setParameter(int index, AUParameterAddress address, AUValue value) {
+		return startRamp(index, address, value, 0);
+	}
+
+	// Control thread. The value as last set, not where its ramp has got to.
+	AUValue getParameter(int index, AUParameterAddress address) const {
+		if (!isInstance(index) || address >= (AUParameterAddress)kParameterCount) {
+			return 0.0f;
+		}
+		return cold[index].values[address];
+	}
+
+	// Control thread.
+	bool startRamp(int index, AUParameterAddress address, AUValue value, AUAudioFrameCount duration) {
+		if (!isInstance(index) || address >= (AUParameterAddress)kParameterCount) {
+			return false;
+		}
+		float const target = clampParameter((int)address, value);
+		if (!push(Command::StartRamp, (uint32_t)index, (int32_t)address, 0, target, duration)) {
+			return false;
+		}
+		cold[index].values[address] = target;
+		return true;
+	}
+
+	// MARK: Notes
+
+	// Control thread. A velocity of 0 releases the instance if it is playing noteNumber.
+	bool noteOn(int index, int noteNumber, int velocity) {
+		return isInstance(index) && push(Command::NoteOn, (uint32_t)index, noteNumber, velocity);
+	}
+
+	// Control thread.
+	bool noteOff(int index) {
+		return isInstance(index) && push(Command::NoteOff, (uint32_t)index);
+	}
+
+	// MARK: Render
+
+	/*
+	 Renders frames of every instance. outputs[i] receives instance i (mono, mixed in like the kernel does)
+	 and may be nullptr for an instance nobody is listening to.
+	 */
+	void render(AUAudioFrameCount frames, float *const *outputs) {
+		if (arena == nullptr) {
+			return;
+		}
+		applyCommands();
+		if (instanceCount == 0) {
+			return;
+		}
+		BasicSynth2DenormalScope denormals(flushDenormals);
+		uint32_t const lanes = (instanceCount + kLaneWidth - 1) / kLaneWidth * kLaneWidth;
+
+		stepRamps(frames, lanes);
+		prepareBlock(lanes);
+
+		for (uint32_t first = 0; first < lanes; first += kLaneWidth) {
+			for (AUAudioFrameCount offset = 0; offset < frames; offset += kControlInterval) {
+				AUAudioFrameCount const count = std::min((AUAudioFrameCount)kControlInterval, frames - offset);
+				alignas(64) float block[kControlInterval][kLaneWidth];
+
+				updateFilters(first);
+				renderLanes(first, count, block);
+
+				for (uint32_t lane = 0; lane < kLaneWidth; ++lane) {
+					uint32_t const index = first + lane;
+					if (index >= instanceCount || outputs[index] == nullptr) {
+						continue;
+					}
+					float *out = outputs[index] + offset;
+					for (AUAudioFrameCount i = 0; i < count; ++i) {
+						out[i] += 0.5f * block[i][lane];
+					}
+				}
+			}
+		}
+	}
+
+	// MARK: Memory
+
+	MemoryReport memoryReport() const {
+		MemoryReport report;
+		report.capacity = capacity;
+		report.instances = liveInstances;
+		report.hotBytesPerInstance = kFieldCount * sizeof(float) + kRampFieldCount * kParameterCount * sizeof(float);
+		report.coldBytesPerInstance = sizeof(ColdInstance);
+		report.totalBytes = sizeof(*this) + arenaFloats() * sizeof(float) + cold.capacity() * sizeof(ColdInstance)
+			+ laneInUse.capacity() + commands.capacity() * sizeof(Command);
+		report.standaloneKernelBytes = sizeof(BasicSynth2DSPKernel) + sizeof(sp_data)
+			+ sizeof(sp_blsquare) + 2 * sizeof(sp_adsr) + 2 * sizeof(sp_butlp);
+		return report;
+	}
+
+	void printMemoryReport() const {
+		MemoryReport const report = memoryReport();
+		std::cout << "BasicSynth2KernelGroup: " << report.instances << " of " << report.capacity << " instances, "
+				  << report.totalBytes / 1024 << " KiB" << std::endl;
+		std::cout << "	per instance: " << report.hotBytesPerInstance << " bytes render state + "
+				  << report.coldBytesPerInstance << " bytes UI state" << std::endl;
+		std::cout << "	standalone kernel: at least " << report.standaloneKernelBytes << " bytes" << std::endl;
+	}
+
+private:
+	enum Stage { StageIdle = 0, StageAttack = 1, StageDecay = 2, StageRelease = 3 };
+
+	struct Command {
+		enum Type : uint8_t { AddInstance, RemoveInstance, StartRamp, NoteOn, NoteOff };
+
+		Type type = AddInstance;
+		uint32_t index = 0;
+		int32_t address = 0;	// parameter address, or note number
+		int32_t velocity = 0;
+		float value = 0;
+		AUAudioFrameCount duration = 0;
+	};
+
+	// Arena fields, in the order the render loop wants them.
+	enum Field {
+		// Read and written every sample.
+		Phase, AmpLevel, AmpStage, FilterLevel, FilterStage, FilterZ1, FilterZ2,
+		// Read every sample, written once per block or control interval.
+		Increment, InverseIncrement, Width, OscillatorAmp,
+		AttackRate, DecayKeep, Sustain, ReleaseKeep,
+		FilterAttackRate, FilterDecayKeep, FilterSustain, FilterReleaseKeep,
+		A1, A4, A5,
+		// Read once per control interval.
+		Cutoff, FilterStrength,
+		// Read once per block: the note playing, or -1.
+		Note,
+		kFieldCount
+	};
+
+	// Per parameter ramp state, read and written once per block, after the fields.
+	enum RampField { Value, Target, Step, FramesLeft, kRampFieldCount };
+
+	uint32_t capacity = 0;
+	uint32_t stride = 0;
+	float sampleRate = 44100;
+
+	// Render thread.
+	float *arena = nullptr;
+	std::vector<uint8_t> laneInUse;
+	uint32_t instanceCount = 0;	// one past the highest lane in use
+
+	// Control thread.
+	std::vector<ColdInstance> cold;
+	uint32_t liveInstances = 0;
+
+	std::vector<Command> commands;
+	alignas(64) std::atomic<uint32_t> commandsWritten { 0 };	// written by the control thread
+	alignas(64) std::atomic<uint32_t> commandsRead { 0 };		// written by the render thread
+
+	size_t arenaFloats() const {
+		return (size_t)stride * (kFieldCount + kRampFieldCount * kParameterCount);
+	}
+
+	float *field(Field which) const {
+		return arena + (size_t)which * stride;
+	}
+
+	float *ramp(RampField which, int address) const {
+		return arena + ((size_t)kFieldCount + (size_t)which * kParameterCount + address) * stride;
+	}
+
+	bool isInstance(int index) const {
+		return index >= 0 && (uint32_t)index < capacity && cold[index].inUse;
+	}
+
+	// MARK: Commands
+
+	bool push(Command::Type type, uint32_t index, int32_t address = 0, int32_t velocity = 0,
+			  float value = 0, AUAudioFrameCount duration = 0) {
+		uint32_t const written = commandsWritten.load(std::memory_order_relaxed);
+		if (commands.empty() || written - commandsRead.load(std::memory_order_acquire) >= kCommandCapacity) {
+			return false;
+		}
+		Command& command = commands[written % kCommandCapacity];
+		command.type = type;
+		command.index = index;
+		command.address = address;
+		command.velocity = velocity;
+		command.value = value;
+		command.duration = duration;
+		commandsWritten.store(written + 1, std::memory_order_release);
+		return true;
+	}
+
+	void applyCommands() {
+		uint32_t const written = commandsWritten.load(std::memory_order_acquire);
+		uint32_t read = commandsRead.load(std::memory_order_relaxed);
+		for (; read != written; ++read) {
+			apply(commands[read % kCommandCapacity]);
+		}
+		commandsRead.store(read, std::memory_order_release);
+	}
+
+	void apply(Command const& command) {
+		uint32_t const index = command.index;
+		switch (command.type) {
+			case Command::AddInstance:
+				resetLane(index);
+				for (int address = 0; address < kParameterCount; ++address) {
+					ramp(Value, address)[index] = defaultValue(address);
+					ramp(Target, address)[index] = defaultValue(address);
+					ramp(Step, address)[index] = 0;
+					ramp(FramesLeft, address)[index] = 0;
+				}
+				laneInUse[index] = 1;
+				instanceCount = std::max(instanceCount, index + 1);
+				break;
+
+			case Command::RemoveInstance:
+				laneInUse[index] = 0;
+				resetLane(index);
+				while (instanceCount > 0 && !laneInUse[instanceCount - 1]) {
+					--instanceCount;
+				}
+				break;
+
+			case Command::StartRamp:
+				ramp(Target, command.address)[index] = command.value;
+				if (command.duration == 0) {
+					ramp(Value, command.address)[index] = command.value;
+					ramp(Step, command.address)[index] = 0;
+					ramp(FramesLeft, command.address)[index] = 0;
+				} else {
+					ramp(Step, command.address)[index] = (command.value - ramp(Value, command.address)[index]) / (float)command.duration;
+					ramp(FramesLeft, command.address)[index] = (float)command.duration;
+				}
+				break;
+
+			case Command::NoteOn:
+				if (command.velocity == 0) {
+					if (field(Note)[index] == (float)command.address) {
+						releaseNote(index);
+					}
+				} else {
+					float const velocityAmp = (float)command.velocity / 127.0f;
+					field(Note)[index] = (float)command.address;
+					field(OscillatorAmp)[index] = velocityAmp * velocityAmp;
+					field(AmpStage)[index] = StageAttack;
+					field(FilterStage)[index] = StageAttack;
+				}
+				break;
+
+			case Command::NoteOff:
+				releaseNote(index);
+				break;
+		}
+	}
+
+	void releaseNote(uint32_t index) {
+		field(Note)[index] = -1.0f;
+		if (field(AmpStage)[index] != StageIdle) {
+			field(AmpStage)[index] = StageRelease;
+		}
+		if (field(FilterStage)[index] != StageIdle) {
+			field(FilterStage)[index] = StageRelease;
+		}
+	}
+
+	void resetLane(uint32_t index) {
+		for (int which = 0; which < kFieldCount; ++which) {
+			field((Field)which)[index] = 0;
+		}
+		field(Increment)[index] = 0.01f;
+		field(InverseIncrement)[index] = 100.0f;
+		field(Width)[index] = 0.5f;
+		field(A1)[index] = 1.0f;
+		field(Note)[index] = -1.0f;
+	}
+
+	// Same defaults and ranges as BasicSynth2DSPKernel, with the adapter's starting cutoff and width.
+	static float defaultValue(int address) {
+		switch (address) {
+			case PitchBendAddress: return 0.0f;
+			case PulseWidthAddress: return 0.5f;
+			case FilterCutoffFrequencyAddress: return 11025.0f;
+			case SustainLevelAddress:
+			case FilterSustainLevelAddress: return 1.0f;
+			case FilterEnvelopeStrengthAddress: return 0.0f;
+			default: return 0.1f;
+		}
+	}
+
+	static float clampParameter(int address, float value) {
+		switch (address) {
+			case PitchBendAddress: return clamp(value, -24.0f, 24.0f);
+			case PulseWidthAddress: return clamp(value, 0.01f, 0.5f);
+			case FilterEnvelopeStrengthAddress: return clamp(value, 0.0f, 1.0f);
+			case FilterCutoffFrequencyAddress: return clamp(value, 0.0f, 22050.0f);
+			default: return clamp(value, 0.0f, 99.0f);
+		}
+	}
+
+	void stepRamps(AUAudioFrameCount frames, uint32_t lanes) {
+		float const elapsed = (float)frames;
+		for (int address = 0; address < kParameterCount; ++address) {
+			float *value = ramp(Value, address);
+			float const *target = ramp(Target, address);
+			float const *step = ramp(Step, address);
+			float *framesLeft = ramp(FramesLeft, address);
+			for (uint32_t lane = 0; lane < lanes; ++lane) {
+				float const steps = std::min(elapsed, framesLeft[lane]);
+				framesLeft[lane] -= steps;
+				value[lane] = framesLeft[lane] > 0 ? value[lane] + step[lane] * steps : target[lane];
+			}
+		}
+	}
+
+	// Block-rate values for every lane: oscillator increment and width, envelope rates, cutoff.
+	void prepareBlock(uint32_t lanes) {
+		float const inverseRate = 1.0f / sampleRate;
+		for (uint32_t lane = 0; lane < instanceCount; ++lane) {
+			float const note = field(Note)[lane];
+			if (!laneInUse[lane] || note < 0) {
+				continue;
+			}
+			float const frequency = 440.0f * exp2f((note - 69.0f + ramp(Value, PitchBendAddress)[lane]) / 12.0f);
+			float const increment = clamp(frequency * inverseRate, 1.0e-7f, 0.49f);
+			field(Increment)[lane] = increment;
+			field(InverseIncrement)[lane] = 1.0f / increment;
+		}
+
+		for (uint32_t lane = 0; lane < lanes; ++lane) {
+			field(Width)[lane] = clamp(ramp(Value, PulseWidthAddress)[lane], 0.01f, 0.5f);
+			field(AttackRate)[lane] = attackRate(ramp(Value, AttackDurationAddress)[lane]);
+			field(DecayKeep)[lane] = decayKeep(ramp(Value, DecayDurationAddress)[lane]);
+			field(Sustain)[lane] = ramp(Value, SustainLevelAddress)[lane];
+			field(ReleaseKeep)[lane] = decayKeep(ramp(Value, ReleaseDurationAddress)[lane]);
+			field(FilterAttackRate)[lane] = attackRate(ramp(Value, FilterAttackDurationAddress)[lane]);
+			field(FilterDecayKeep)[lane] = decayKeep(ramp(Value, FilterDecayDurationAddress)[lane]);
+			field(FilterSustain)[lane] = ramp(Value, FilterSustainLevelAddress)[lane];
+			field(FilterReleaseKeep)[lane] = decayKeep(ramp(Value, FilterReleaseDurationAddress)[lane]);
+			field(Cutoff)[lane] = ramp(Value, FilterCutoffFrequencyAddress)[lane];
+			field(FilterStrength)[lane] = ramp(Value, FilterEnvelopeStrengthAddress)[lane];
+		}
+	}
+
+	// The envelopes are one-pole segments timed like sp_adsr's, which the kernel's are: an attack heads for
+	// full scale with a time constant of 0.75 times its duration, and hands over to the decay after two time
+	// constants. Decays and releases have their durations as time constants.
+	float attackRate(float seconds) const {
+		float const samples = std::max(0.75f * seconds * sampleRate, 1.0f);
+		return 1.0f - expf(-1.0f / samples);
+	}
+
+	float decayKeep(float seconds) const {
+		float const samples = std::max(seconds * sampleRate, 1.0f);
+		return expf(-1.0f / samples);
+	}
+
+	// Soundpipe's butlp coefficients, for the cutoff the filter envelope has reached.
+	void updateFilters(uint32_t first) {
+		float const nyquistLimit = std::min(22050.0f, 0.49f * sampleRate);
+		float const pidsr = (float)M_PI / sampleRate;
+		for (uint32_t lane = first; lane < first + kLaneWidth; ++lane) {
+			float const cutoff = field(Cutoff)[lane];
+			float const amount = field(FilterLevel)[lane] * field(FilterStrength)[lane];
+			float const frequency = clamp(cutoff + (22050.0f - cutoff) * amount, 10.0f, nyquistLimit);
+
+			float const c = 1.0f / tanf(pidsr * frequency);
+			float const a1 = 1.0f / (1.0f + (float)M_SQRT2 * c + c * c);
+			field(A1)[lane] = a1;
+			field(A4)[lane] = 2.0f * (1.0f - c * c) * a1;
+			field(A5)[lane] = (1.0f - (float)M_SQRT2 * c + c * c) * a1;
+		}
+	}
+
+	/*
+	 Lanes first..first + kLaneWidth for count frames. The slice of every per-sample field is copied into a
+	 local array first and the changed fields are written back after, so the compiler can see nothing aliases
+	 and the loop over the lanes, which has no branches, turns into vector instructions.
+	 */
+	void renderLanes(uint32_t first, AUAudioFrameCount count, float (*block)[kLaneWidth]) {
+		alignas(64) float s[Cutoff][kLaneWidth];
+		for (int which = 0; which < Cutoff; ++which) {
+			memcpy(s[which], field((Field)which) + first, sizeof(s[which]));
+		}
+
+		for (AUAudioFrameCount frame = 0; frame < count; ++frame) {
+			for (int lane = 0; lane < kLaneWidth; ++lane) {
+				// PolyBLEP pulse, with BasicSynth2UnisonOscillator's correction.
+				float const t = s[Phase][lane];
+				float const dt = s[Increment][lane];
+				float const inverseDt = s[InverseIncrement][lane];
+				float const pw = s[Width][lane];
+				float const unwrapped = t + 1.0f - pw;
+				float const wrapped = unwrapped - 1.0f;
+				float const shifted = unwrapped >= 1.0f ? wrapped : unwrapped;
+				float const naive = t < pw ? 1.0f : -1.0f;
+				float const pulse = naive + BasicSynth2UnisonOscillator::polyBlep(t, inverseDt)
+					- BasicSynth2UnisonOscillator::polyBlep(shifted, inverseDt);
+				float const next = t + dt;
+				float const nextWrapped = next - 1.0f;
+				s[Phase][lane] = next >= 1.0f ? nextWrapped : next;
+
+				envelope(s[AmpLevel][lane], s[AmpStage][lane], s[AttackRate][lane], s[DecayKeep][lane], s[Sustain][lane], s[ReleaseKeep][lane]);
+				envelope(s[FilterLevel][lane], s[FilterStage][lane], s[FilterAttackRate][lane], s[FilterDecayKeep][lane], s[FilterSustain][lane], s[FilterReleaseKeep][lane]);
+
+				// Butterworth lowpass, direct form II like sp_butlp.
+				float const z1 = s[FilterZ1][lane];
+				float const z2 = s[FilterZ2][lane];
+				float const w = pulse * s[OscillatorAmp][lane] - s[A4][lane] * z1 - s[A5][lane] * z2;
+				float const output = (w + 2.0f * z1 + z2) * s[A1][lane];
+				s[FilterZ2][lane] = z1;
+				s[FilterZ1][lane] = w;
+
+				block[frame][lane] = output * s[AmpLevel][lane];
+			}
+		}
+
+		// Idle lanes keep their filters at exactly zero rather than decaying through the denormal range.
+		for (int lane = 0; lane < kLaneWidth; ++lane) {
+			bool const idle = s[AmpStage][lane] == StageIdle;
+			s[FilterZ1][lane] = idle ? 0.0f : s[FilterZ1][lane];
+			s[FilterZ2][lane] = idle ? 0.0f : s[FilterZ2][lane];
+		}
+
+		for (int which = Phase; which <= FilterZ2; ++which) {
+			memcpy(field((Field)which) + first, s[which], sizeof(s[which]));
+		}
+	}
+
+	// One step of an exponential ADSR. Every segment is computed and the stage picks one, so there is
+	// nothing conditional but selects and the loop vectorizes across lanes.
+	static inline void envelope(float &level, float &stage, float attackRate, float decayKeep, float sustainLevel, float releaseKeep) {
+		float const current = stage;
+		float const attacked = level + (1.0f - level) * attackRate;
+		float const decayed = sustainLevel + (level - sustainLevel) * decayKeep;
+		float const released = level * releaseKeep;
+
+		float next = current == StageAttack ? attacked : 0.0f;
+		next = current == StageDecay ? decayed : next;
+		next = current == StageRelease ? released : next;
+
+		// Two time constants from silence: 1 - e^-2.
+		bool const peaked = (current == StageAttack) & (next >= 0.8646647f);
+		bool const finished = (current == StageRelease) & (next < 1.0e-5f);
+		// peaked and finished never hold together. Both selects test finished first: GCC only
+		// vectorizes the lane loop when they have the same shape.
+		level = finished ? 0.0f : next;
+		stage = finished ? (float)StageIdle : (peaked ? (float)StageDecay : current);
+	}
+};
+
+#endif /* BasicSynth2KernelGroup_hpp */
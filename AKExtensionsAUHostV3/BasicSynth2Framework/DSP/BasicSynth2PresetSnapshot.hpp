@@ -0,0 +1,213 @@
+//
+//  BasicSynth2PresetSnapshot.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2PresetSnapshot_hpp
+#define BasicSynth2PresetSnapshot_hpp
+
+#import <AudioToolbox/AudioToolbox.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// MARK: - BasicSynth2PresetSnapshot
+/*
+ BasicSynth2PresetSnapshot
+
+ Plain-old-data copy of every parameter value, indexed by parameter address.
+ The layout is fixed size so a bank of them can be memory-mapped and used in place.
+ Values are stored in native byte order (every Apple platform we ship on is little endian).
+
+ parameterCount records how many addresses were valid when the snapshot was written,
+ so a newer kernel can still apply an older snapshot and leave the newer parameters alone.
+ */
+enum {
+	kBasicSynth2PresetSnapshotMagic = 0x50325342, // 'BS2P'
+	kBasicSynth2PresetSnapshotVersion = 1,
+	kBasicSynth2PresetSnapshotMaxParameters = 32
+};
+
+struct BasicSynth2PresetSnapshot {
+	uint32_t magic = kBasicSynth2PresetSnapshotMagic;
+	uint16_t version = kBasicSynth2PresetSnapshotVersion;
+	uint16_t parameterCount = 0;
+	float values[kBasicSynth2PresetSnapshotMaxParameters] = {};
+
+	bool isValid() const {
+		return magic == kBasicSynth2PresetSnapshotMagic
+			&& version <= kBasicSynth2PresetSnapshotVersion
+			&& parameterCount <= kBasicSynth2PresetSnapshotMaxParameters;
+	}
+};
+
+static_assert(std::is_trivially_copyable<BasicSynth2PresetSnapshot>::value, "Snapshots are copied and mapped as raw bytes");
+static_assert(std::is_standard_layout<BasicSynth2PresetSnapshot>::value, "Snapshots are copied and mapped as raw bytes");
+
+
+// MARK: - BasicSynth2PresetMailbox
+/*
+ BasicSynth2PresetMailbox
+
+ Hands a snapshot from the UI thread to the render thread without locks.
+ It's a triple buffer: the writer fills its private slot and swaps it into the middle with one atomic
+ exchange, and the reader swaps the middle slot out the same way. Neither side ever waits on the other,
+ and if the UI publishes twice before the next render cycle only the latest snapshot gets applied.
+
+ Single producer (UI thread), single consumer (render thread).
+ */
+class BasicSynth2PresetMailbox {
+public:
+	struct Pending {
+		BasicSynth2PresetSnapshot snapshot;
+		AUAudioFrameCount rampFrames = 0;
+	};
+
+	// UI thread.
+	void publish(BasicSynth2PresetSnapshot const& snapshot, AUAudioFrameCount rampFrames) {
+		slots[writeSlot].snapshot = snapshot;
+		slots[writeSlot].rampFrames = rampFrames;
+		writeSlot = middle.exchange(writeSlot | dirtyFlag, std::memory_order_acq_rel) & indexMask;
+	}
+
+	// Render thread. Returns nullptr when nothing new has been published.
+	// The returned slot stays untouched by the writer until the next call to consume().
+	Pending const* consume() {
+		if ((middle.load(std::memory_order_relaxed) & dirtyFlag) == 0) {
+			return nullptr;
+		}
+		readSlot = middle.exchange(readSlot, std::memory_order_acq_rel) & indexMask;
+		return &slots[readSlot];
+	}
+
+private:
+	enum : uint8_t { indexMask = 0x3, dirtyFlag = 0x4 };
+
+	Pending slots[3];
+	std::atomic<uint8_t> middle { 1 };
+	uint8_t writeSlot = 0;
+	uint8_t readSlot = 2;
+};
+
+
+// MARK: - BasicSynth2PresetBank
+/*
+ BasicSynth2PresetBank
+
+ A preset bank file is a small header followed by a packed array of BasicSynth2PresetSnapshot.
+ open() maps the file read-only and entries are handed out as pointers straight into the mapping,
+ so opening a bank with thousands of presets costs one mmap and pages are faulted in on demand.
+ */
+class BasicSynth2PresetBank {
+public:
+	struct FileHeader {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t entrySize;
+		uint32_t entryCount;
+		uint32_t reserved;
+	};
+
+	enum {
+		kMagic = 0x42325342, // 'BS2B'
+		kVersion = 1
+	};
+
+	BasicSynth2PresetBank() = default;
+	BasicSynth2PresetBank(BasicSynth2PresetBank const&) = delete;
+	BasicSynth2PresetBank& operator=(BasicSynth2PresetBank const&) = delete;
+
+	~BasicSynth2PresetBank() {
+		close();
+	}
+
+	bool open(char const* path) {
+		close();
+
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(FileHeader)) {
+			::close(fd);
+			return false;
+		}
+
+		void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (mapped == MAP_FAILED) {
+			return false;
+		}
+
+		FileHeader const* header = (FileHeader const*)mapped;
+		size_t const expectedSize = sizeof(FileHeader) + (size_t)header->entryCount * sizeof(BasicSynth2PresetSnapshot);
+		if (header->magic != kMagic
+			|| header->version > kVersion
+			|| header->entrySize != sizeof(BasicSynth2PresetSnapshot)
+			|| (size_t)info.st_size < expectedSize) {
+			munmap(mapped, (size_t)info.st_size);
+			return false;
+		}
+
+		mappedBytes = mapped;
+		mappedLength = (size_t)info.st_size;
+		count = header->entryCount;
+		entries = (BasicSynth2PresetSnapshot const*)((uint8_t const*)mapped + sizeof(FileHeader));
+		return true;
+	}
+
+	void close() {
+		if (mappedBytes != nullptr) {
+			munmap(mappedBytes, mappedLength);
+		}
+		mappedBytes = nullptr;
+		mappedLength = 0;
+		entries = nullptr;
+		count = 0;
+	}
+
+	uint32_t size() const { return count; }
+
+	// Zero-copy access into the mapping. Returns nullptr for out of range or corrupt entries.
+	BasicSynth2PresetSnapshot const* entry(uint32_t index) const {
+		if (index >= count || !entries[index].isValid()) {
+			return nullptr;
+		}
+		return &entries[index];
+	}
+
+	static bool write(char const* path, BasicSynth2PresetSnapshot const* snapshots, uint32_t snapshotCount) {
+		FILE* file = fopen(path, "wb");
+		if (file == nullptr) {
+			return false;
+		}
+
+		FileHeader header = { kMagic, kVersion, (uint16_t)sizeof(BasicSynth2PresetSnapshot), snapshotCount, 0 };
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		if (ok && snapshotCount > 0) {
+			ok = fwrite(snapshots, sizeof(BasicSynth2PresetSnapshot), snapshotCount, file) == snapshotCount;
+		}
+		return (fclose(file) == 0) && ok;
+	}
+
+private:
+	void* mappedBytes = nullptr;
+	size_t mappedLength = 0;
+	BasicSynth2PresetSnapshot const* entries = nullptr;
+	uint32_t count = 0;
+};
+
+static_assert(sizeof(BasicSynth2PresetBank::FileHeader) == 16, "Keep the bank header packed and entries 4-byte aligned");
+
+#endif /* BasicSynth2PresetSnapshot_hpp */
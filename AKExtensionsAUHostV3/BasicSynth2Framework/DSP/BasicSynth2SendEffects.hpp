@@ -0,0 +1,309 @@
+//
+//  BasicSynth2SendEffects.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2SendEffects_hpp
+#define BasicSynth2SendEffects_hpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// MARK: - BasicSynth2DelayLine
+/*
+ BasicSynth2DelayLine
+
+ A ring buffer whose length is a power of two, so wrapping is a mask, and whose storage starts on a
+ cache line. Reads and writes move whole chunks: as long as the delay is at least as long as the chunk,
+ a chunk's reads never see its own writes, so both are plain (at most two-piece) contiguous copies and
+ the processing between them is free to vectorize.
+ */
+struct BasicSynth2DelayLine {
+	enum { kAlignment = 64 };
+
+	float *buffer = nullptr;
+	uint32_t length = 0;
+	uint32_t mask = 0;
+	uint32_t writeIndex = 0;
+
+	BasicSynth2DelayLine() = default;
+	BasicSynth2DelayLine(BasicSynth2DelayLine const&) = delete;
+	BasicSynth2DelayLine& operator=(BasicSynth2DelayLine const&) = delete;
+
+	~BasicSynth2DelayLine() {
+		release();
+	}
+
+	// Not real-time safe.
+	bool allocate(uint32_t minimumLength) {
+		release();
+
+		uint32_t size = kAlignment / sizeof(float);
+		while (size < minimumLength) {
+			size <<= 1;
+		}
+
+		void *memory = nullptr;
+		if (posix_memalign(&memory, kAlignment, size * sizeof(float)) != 0) {
+			return false;
+		}
+		buffer = (float *)memory;
+		length = size;
+		mask = size - 1;
+		clear();
+		return true;
+	}
+
+	void release() {
+		free(buffer);
+		buffer = nullptr;
+		length = 0;
+		mask = 0;
+		writeIndex = 0;
+	}
+
+	void clear() {
+		if (buffer != nullptr) {
+			memset(buffer, 0, length * sizeof(float));
+		}
+		writeIndex = 0;
+	}
+
+	// The frames samples written delay samples before the next write. delay must be at least frames.
+	void read(float *out, uint32_t delay, uint32_t frames) const {
+		uint32_t const start = (writeIndex - delay) & mask;
+		uint32_t const first = std::min(frames, length - start);
+		memcpy(out, buffer + start, first * sizeof(float));
+		memcpy(out + first, buffer, (frames - first) * sizeof(float));
+	}
+
+	void write(float const *in, uint32_t frames) {
+		uint32_t const first = std::min(frames, length - writeIndex);
+		memcpy(buffer + writeIndex, in, first * sizeof(float));
+		memcpy(buffer, in + first, (frames - first) * sizeof(float));
+		writeIndex = (writeIndex + frames) & mask;
+	}
+};
+
+
+// MARK: - BasicSynth2SendEffects
+/*
+ BasicSynth2SendEffects
+
+ A send bus with a stereo feedback delay and an algorithmic reverb in parallel, run once on the kernel's
+ summed output: the send level taps the dry signal, and both effect returns are mixed back on top of it.
+
+ The reverb is an 8 line feedback delay network: each line's output goes through a one-pole damping
+ filter, the 8 lines are mixed by a scaled Hadamard matrix and fed back in. The lines are stored and
+ processed structure-of-arrays, one lane per line, so the per-sample work is a few 8-wide vector operations.
+
+ Everything runs in chunks of kChunk frames, which is shorter than the shortest delay, so each line is
+ read and written with contiguous copies once per chunk.
+
+ Buffers are allocated by allocate(), from init() at allocateRenderResources time; process() never allocates.
+ */
+struct BasicSynth2SendEffects {
+	// kMaximumDelayTime is the longest delay time, in seconds, that the buffers are sized for.
+	enum { kChunk = 64, kReverbLines = 8, kMaximumDelayTime = 2 };
+
+	bool allocate(double sampleRate) {
+		rate = (float)sampleRate;
+		bool ok = sampleRate > 0;
+
+		uint32_t const delayLength = (uint32_t)(kMaximumDelayTime * sampleRate) + kChunk;
+		ok = ok && delayLeft.allocate(delayLength) && delayRight.allocate(delayLength);
+
+		// Mutually prime lengths around 25-37 ms at 44.1 kHz, scaled to the sample rate.
+		static uint32_t const baseLengths[kReverbLines] = { 1116, 1188, 1277, 1356, 1422, 1491, 1557, 1617 };
+		for (int line = 0; line < kReverbLines; ++line) {
+			reverbDelays[line] = std::max((uint32_t)kChunk, (uint32_t)(baseLengths[line] * sampleRate / 44100.0));
+			ok = ok && reverbLines[line].allocate(reverbDelays[line] + kChunk);
+		}
+
+		clear();
+		return ok;
+	}
+
+	void release() {
+		delayLeft.release();
+		delayRight.release();
+		for (BasicSynth2DelayLine &line : reverbLines) {
+			line.release();
+		}
+		active = false;
+	}
+
+	void clear() {
+		delayLeft.clear();
+		delayRight.clear();
+		for (int line = 0; line < kReverbLines; ++line) {
+			reverbLines[line].clear();
+			damping[line] = 0;
+		}
+		silentFrames = 0;
+		active = false;
+	}
+
+	bool isAllocated() const { return delayLeft.buffer != nullptr; }
+
+	// Still has a tail to play out, even if nothing is being sent.
+	bool isActive() const { return active; }
+
+	// Block-rate settings. Times are in seconds, everything else is 0...1.
+	void prepare(float sendLevel, float delayTime, float delayFeedback, float delayLevel,
+				 float reverbSize, float reverbDamping, float reverbLevel) {
+		send = std::min(std::max(sendLevel, 0.0f), 1.0f);
+		float const delayFrames = std::min(std::max(delayTime, 0.0f), (float)kMaximumDelayTime) * rate;
+		delaySamples = std::min(std::max((uint32_t)delayFrames, (uint32_t)kChunk), delayLeft.length - kChunk);
+		feedback = std::min(std::max(delayFeedback, 0.0f), 0.95f);
+		delayGain = std::min(std::max(delayLevel, 0.0f), 1.0f);
+
+		// Feedback gain per pass, folded into the Hadamard matrix's 1/sqrt(8) normalization.
+		float const decay = 0.7f + 0.28f * std::min(std::max(reverbSize, 0.0f), 1.0f);
+		reverbFeedback = decay * 0.35355339f;
+		dampingCoefficient = 1.0f - 0.9f * std::min(std::max(reverbDamping, 0.0f), 1.0f);
+		reverbGain = std::min(std::max(reverbLevel, 0.0f), 1.0f);
+
+		if (send > 0) {
+			active = true;
+		}
+	}
+
+	// Mixes the effect returns into left and right (which may be the same buffer, for mono output).
+	void process(float *left, float *right, uint32_t frames) {
+		if (!active || !isAllocated()) {
+			return;
+		}
+
+		float peak = 0;
+		for (uint32_t offset = 0; offset < frames; offset += kChunk) {
+			uint32_t const chunk = std::min((uint32_t)kChunk, frames - offset);
+			peak = std::max(peak, processChunk(left + offset, right + offset, chunk, left == right));
+		}
+
+		// With nothing going in, stop once everything in the lines has had time to come out and died away.
+		if (send == 0 && peak < 1.0e-6f) {
+			silentFrames += frames;
+			if (silentFrames > delaySamples + reverbDelays[kReverbLines - 1]) {
+				clear();
+			}
+		} else {
+			silentFrames = 0;
+		}
+	}
+
+private:
+	BasicSynth2DelayLine delayLeft;
+	BasicSynth2DelayLine delayRight;
+	BasicSynth2DelayLine reverbLines[kReverbLines];
+	uint32_t reverbDelays[kReverbLines] = {};
+	alignas(16) float damping[kReverbLines] = {};
+
+	float rate = 44100;
+	float send = 0;
+	uint32_t delaySamples = kChunk;
+	float feedback = 0;
+	float delayGain = 0;
+	float reverbFeedback = 0;
+	float dampingCoefficient = 1;
+	float reverbGain = 0;
+
+	bool active = false;
+	uint32_t silentFrames = 0;
+
+	// Returns the peak of the wet signal.
+	float processChunk(float *left, float *right, uint32_t frames, bool mono) {
+		alignas(64) float sendLeft[kChunk];
+		alignas(64) float sendRight[kChunk];
+		for (uint32_t i = 0; i < frames; ++i) {
+			sendLeft[i] = left[i] * send;
+			sendRight[i] = right[i] * send;
+		}
+
+		// Delay: read the taps, feed them back with the new input, write the chunk.
+		alignas(64) float tapLeft[kChunk];
+		alignas(64) float tapRight[kChunk];
+		alignas(64) float lineIn[kChunk];
+		delayLeft.read(tapLeft, delaySamples, frames);
+		delayRight.read(tapRight, delaySamples, frames);
+		for (uint32_t i = 0; i < frames; ++i) {
+			lineIn[i] = sendLeft[i] + tapLeft[i] * feedback;
+		}
+		delayLeft.write(lineIn, frames);
+		for (uint32_t i = 0; i < frames; ++i) {
+			lineIn[i] = sendRight[i] + tapRight[i] * feedback;
+		}
+		delayRight.write(lineIn, frames);
+
+		// Reverb: every line's taps for the chunk, then the network one sample at a time across the 8 lanes.
+		alignas(64) float taps[kReverbLines][kChunk];
+		alignas(64) float feeds[kReverbLines][kChunk];
+		alignas(64) float wetLeft[kChunk];
+		alignas(64) float wetRight[kChunk];
+		for (int line = 0; line < kReverbLines; ++line) {
+			reverbLines[line].read(taps[line], reverbDelays[line], frames);
+		}
+
+		alignas(32) float state[kReverbLines];
+		std::copy(damping, damping + kReverbLines, state);
+		float const coefficient = dampingCoefficient;
+		float const gain = reverbFeedback;
+
+		for (uint32_t i = 0; i < frames; ++i) {
+			alignas(32) float v[kReverbLines];
+			for (int line = 0; line < kReverbLines; ++line) {
+				state[line] += coefficient * (taps[line][i] - state[line]);
+				v[line] = state[line];
+			}
+
+			wetLeft[i] = (v[0] + v[2] + v[4] + v[6]) * 0.5f;
+			wetRight[i] = (v[1] + v[3] + v[5] + v[7]) * 0.5f;
+
+			hadamard(v);
+			for (int line = 0; line < kReverbLines; ++line) {
+				feeds[line][i] = v[line] * gain + ((line & 1) ? sendRight[i] : sendLeft[i]) * 0.25f;
+			}
+		}
+		std::copy(state, state + kReverbLines, damping);
+
+		for (int line = 0; line < kReverbLines; ++line) {
+			reverbLines[line].write(feeds[line], frames);
+		}
+
+		// Returns.
+		float peak = 0;
+		for (uint32_t i = 0; i < frames; ++i) {
+			float const outLeft = tapLeft[i] * delayGain + wetLeft[i] * reverbGain;
+			float const outRight = tapRight[i] * delayGain + wetRight[i] * reverbGain;
+			peak = std::max(peak, std::max(fabsf(outLeft), fabsf(outRight)));
+			if (mono) {
+				left[i] += 0.5f * (outLeft + outRight);
+			} else {
+				left[i] += outLeft;
+				right[i] += outRight;
+			}
+		}
+		return peak;
+	}
+
+	// In-place, unnormalized 8 point fast Hadamard transform.
+	static inline void hadamard(float *v) {
+		for (int span = 1; span < kReverbLines; span <<= 1) {
+			for (int i = 0; i < kReverbLines; i += span << 1) {
+				for (int j = i; j < i + span; ++j) {
+					float const a = v[j];
+					float const b = v[j + span];
+					v[j] = a + b;
+					v[j + span] = a - b;
+				}
+			}
+		}
+	}
+};
+
+#endif /* BasicSynth2SendEffects_hpp */
@@ -0,0 +1,134 @@
+//
+//  BasicSynth2Unison.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2Unison_hpp
+#define BasicSynth2Unison_hpp
+
+#include <algorithm>
+#include <cmath>
+
+// MARK: - BasicSynth2UnisonOscillator
+/*
+ BasicSynth2UnisonOscillator
+
+ A stack of up to 16 detuned PolyBLEP pulse oscillators, spread across the stereo field.
+
+ The sub-oscillators are stored structure-of-arrays, padded to a multiple of kLaneWidth, and the
+ per-sample loop over them is written as arithmetic, clamps and compares with no conditional work, so
+ the compiler turns it into a handful of vector instructions: 8 unison voices cost about as much as two
+ 4-wide oscillator updates, not 8 scalar ones. Padding lanes run at a harmless rate with zero gain.
+
+ Clang vectorizes the loop with its default floating point model. GCC only does with -fno-trapping-math:
+ by default it turns the clamps back into branches and then won't run the arithmetic under them unconditionally.
+
+ Frequencies, gains and width are fixed per block by prepare().
+ */
+struct BasicSynth2UnisonOscillator {
+	enum { kMaxVoices = 16, kLaneWidth = 8 };
+
+	alignas(16) float phase[kMaxVoices];
+	alignas(16) float increment[kMaxVoices];
+	alignas(16) float inverseIncrement[kMaxVoices];
+	alignas(16) float gainLeft[kMaxVoices];
+	alignas(16) float gainRight[kMaxVoices];
+
+	int voices = 1;
+	int lanes = kLaneWidth;
+	float width = 0.5f;
+
+	BasicSynth2UnisonOscillator() {
+		reset();
+	}
+
+	// Spreads the starting phases so the stack doesn't start with every voice in phase.
+	void reset() {
+		for (int lane = 0; lane < kMaxVoices; ++lane) {
+			float const golden = 0.61803398875f * (float)lane;
+			phase[lane] = golden - floorf(golden);
+		}
+	}
+
+	/*
+	 detuneCents is the distance from the centre to the outermost voices.
+	 stereoSpread 0 keeps every voice centred, 1 pans the outermost voices hard left and right.
+	 */
+	void prepare(int voiceCount, float frequency, float sampleRate, float detuneCents, float stereoSpread, float pulseWidth) {
+		voices = std::min(std::max(voiceCount, 1), (int)kMaxVoices);
+		lanes = (voices + kLaneWidth - 1) / kLaneWidth * kLaneWidth;
+		width = std::min(std::max(pulseWidth, 0.01f), 0.99f);
+
+		// Equal-power sum, so the level doesn't jump when the voice count changes.
+		float const normalize = 1.0f / sqrtf((float)voices);
+
+		for (int lane = 0; lane < lanes; ++lane) {
+			if (lane >= voices || sampleRate <= 0) {
+				increment[lane] = 0.25f;
+				inverseIncrement[lane] = 4.0f;
+				gainLeft[lane] = 0;
+				gainRight[lane] = 0;
+				continue;
+			}
+
+			float const position = voices > 1 ? (2.0f * (float)lane / (float)(voices - 1) - 1.0f) : 0.0f;
+			float const ratio = exp2f(position * detuneCents / 1200.0f);
+			float const laneIncrement = std::min(std::max(frequency * ratio / sampleRate, 1.0e-7f), 0.49f);
+			increment[lane] = laneIncrement;
+			inverseIncrement[lane] = 1.0f / laneIncrement;
+
+			float const pan = (position * stereoSpread + 1.0f) * (float)M_PI_4;
+			gainLeft[lane] = cosf(pan) * normalize;
+			gainRight[lane] = sinf(pan) * normalize;
+		}
+	}
+
+	void compute(float &left, float &right) {
+		alignas(64) float outLeft[kMaxVoices];
+		alignas(64) float outRight[kMaxVoices];
+		float const pulseWidth = width;
+
+		for (int lane = 0; lane < lanes; ++lane) {
+			float const t = phase[lane];
+			float const dt = increment[lane];
+			float const inverseDt = inverseIncrement[lane];
+
+			float const unwrapped = t + 1.0f - pulseWidth;
+			float const shifted = unwrapped - (float)(unwrapped >= 1.0f);
+
+			float const naive = t < pulseWidth ? 1.0f : -1.0f;
+			float const y = naive + polyBlep(t, inverseDt) - polyBlep(shifted, inverseDt);
+
+			outLeft[lane] = y * gainLeft[lane];
+			outRight[lane] = y * gainRight[lane];
+
+			// Wraps by subtracting the compare result rather than selecting between two values.
+			float const next = t + dt;
+			phase[lane] = next - (float)(next >= 1.0f);
+		}
+
+		float sumLeft = 0;
+		float sumRight = 0;
+		for (int lane = 0; lane < lanes; ++lane) {
+			sumLeft += outLeft[lane];
+			sumRight += outRight[lane];
+		}
+		left = sumLeft;
+		right = sumRight;
+	}
+
+	// The PolyBLEP correction at phase t, also used by BasicSynth2KernelGroup's lane loop.
+	// Both corrections are computed and added. Each is clamped to the end of its region outside it,
+	// where the polynomial is exactly zero, so the lane loop needs no selects on computed values.
+	static inline float polyBlep(float t, float inverseDt) {
+		float const head = std::min(t * inverseDt, 1.0f);
+		float const tail = std::max((t - 1.0f) * inverseDt, -1.0f);
+		float const headValue = head + head - head * head - 1.0f;
+		float const tailValue = tail * tail + tail + tail + 1.0f;
+		return headValue + tailValue;
+	}
+};
+
+#endif /* BasicSynth2Unison_hpp */
@@ -0,0 +1,346 @@
+//
+//  BasicSynth2Wavetable.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2Wavetable_hpp
+#define BasicSynth2Wavetable_hpp
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// MARK: - BasicSynth2WavetableBank
+/*
+ BasicSynth2WavetableBank
+
+ A bank holds frameCount single-cycle waveforms ("frames", morphed between by the position parameter),
+ each stored as octaveCount band-limited copies: octave 0 carries every harmonic the table can hold,
+ and each octave above it carries half as many. The oscillator picks the octave whose harmonics all stay
+ below Nyquist for the note being played, so playback is alias-free with a plain interpolated read.
+
+ On disk a bank is a 64 byte header followed by the tables as packed native floats:
+
+	data[frame][octave][tableLength]
+
+ Every table is a power of two long and starts on a 64 byte boundary, both in the file and in memory.
+ open() maps the file read-only and shared, so large banks load instantly and the pages are shared
+ by every instance (and every process) using the same file.
+ */
+class BasicSynth2WavetableBank {
+public:
+	struct FileHeader {
+		uint32_t magic;
+		uint16_t version;
+		uint16_t octaveCount;
+		uint32_t tableLength;
+		uint32_t frameCount;
+		uint32_t dataOffset;
+		uint32_t reserved[11];
+	};
+
+	enum {
+		kMagic = 0x57325342, // 'BS2W'
+		kVersion = 1,
+		kAlignment = 64,
+		kMinimumTableLength = 16,
+		kMaximumTableLength = 1 << 16
+	};
+
+	BasicSynth2WavetableBank() = default;
+	BasicSynth2WavetableBank(BasicSynth2WavetableBank const&) = delete;
+	BasicSynth2WavetableBank& operator=(BasicSynth2WavetableBank const&) = delete;
+
+	~BasicSynth2WavetableBank() {
+		close();
+	}
+
+	bool open(char const* path) {
+		close();
+
+		int fd = ::open(path, O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(FileHeader)) {
+			::close(fd);
+			return false;
+		}
+
+		void* mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+		if (mapped == MAP_FAILED) {
+			return false;
+		}
+
+		FileHeader const* header = (FileHeader const*)mapped;
+		if (header->magic != kMagic
+			|| header->version > kVersion
+			|| !isValidLayout(header->tableLength, header->octaveCount, header->frameCount)
+			|| header->dataOffset % kAlignment != 0
+			|| (size_t)info.st_size < header->dataOffset + dataSize(header->tableLength, header->octaveCount, header->frameCount)) {
+			munmap(mapped, (size_t)info.st_size);
+			return false;
+		}
+
+		mappedBytes = mapped;
+		mappedLength = (size_t)info.st_size;
+		setLayout((float const*)((uint8_t const*)mapped + header->dataOffset), header->tableLength, header->octaveCount, header->frameCount);
+		return true;
+	}
+
+	/*
+	 Builds a bank in memory from harmonic amplitudes (sine phase).
+	 harmonics holds frameCount rows of harmonicCount amplitudes, for harmonics 1...harmonicCount.
+	 Each frame is normalized to a peak of 1, using the same gain for all of its octaves.
+	 Not real-time safe: call it from init or a loading thread.
+	 */
+	bool build(float const* harmonics, uint32_t harmonicCount, uint32_t frames, uint32_t length, uint32_t octaves) {
+		close();
+
+		if (!isValidLayout(length, octaves, frames)) {
+			return false;
+		}
+
+		void* memory = nullptr;
+		if (posix_memalign(&memory, kAlignment, dataSize(length, octaves, frames)) != 0) {
+			return false;
+		}
+		ownedBytes = (float*)memory;
+		setLayout(ownedBytes, length, octaves, frames);
+
+		float* sine = (float*)malloc(length * sizeof(float));
+		float* sum = (float*)malloc(length * sizeof(float));
+		if (sine == nullptr || sum == nullptr) {
+			free(sine);
+			free(sum);
+			close();
+			return false;
+		}
+		for (uint32_t i = 0; i < length; ++i) {
+			sine[i] = (float)sin(2.0 * M_PI * i / length);
+		}
+
+		for (uint32_t frame = 0; frame < frames; ++frame) {
+			float const* amplitudes = harmonics + (size_t)frame * harmonicCount;
+			memset(sum, 0, length * sizeof(float));
+
+			// Work from the top octave (fewest harmonics) down, adding the extra harmonics each octave allows.
+			uint32_t harmonicsSoFar = 0;
+			for (int octave = (int)octaves - 1; octave >= 0; --octave) {
+				uint32_t const limit = std::min(harmonicCount, harmonicsForOctave((uint32_t)octave));
+				for (uint32_t harmonic = harmonicsSoFar + 1; harmonic <= limit; ++harmonic) {
+					float const amplitude = amplitudes[harmonic - 1];
+					if (amplitude == 0) {
+						continue;
+					}
+					for (uint32_t i = 0; i < length; ++i) {
+						sum[i] += amplitude * sine[(harmonic * i) & mask];
+					}
+				}
+				harmonicsSoFar = std::max(harmonicsSoFar, limit);
+				memcpy(ownedBytes + tableOffset(frame, (uint32_t)octave), sum, length * sizeof(float));
+			}
+
+			// sum now holds octave 0, the fullest version of the frame.
+			float peak = 0;
+			for (uint32_t i = 0; i < length; ++i) {
+				peak = std::max(peak, fabsf(sum[i]));
+			}
+			if (peak > 0) {
+				float const gain = 1.0f / peak;
+				float* frameData = ownedBytes + tableOffset(frame, 0);
+				for (size_t i = 0; i < (size_t)octaves * length; ++i) {
+					frameData[i] *= gain;
+				}
+			}
+		}
+
+		free(sine);
+		free(sum);
+		return true;
+	}
+
+	// Writes the bank in the format open() reads.
+	bool write(char const* path) const {
+		if (data == nullptr) {
+			return false;
+		}
+
+		FILE* file = fopen(path, "wb");
+		if (file == nullptr) {
+			return false;
+		}
+
+		FileHeader header = {};
+		header.magic = kMagic;
+		header.version = kVersion;
+		header.octaveCount = (uint16_t)octaveCount;
+		header.tableLength = tableLength;
+		header.frameCount = frameCount;
+		header.dataOffset = sizeof(FileHeader);
+
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		ok = ok && fwrite(data, dataSize(tableLength, octaveCount, frameCount), 1, file) == 1;
+		return (fclose(file) == 0) && ok;
+	}
+
+	void close() {
+		if (mappedBytes != nullptr) {
+			munmap(mappedBytes, mappedLength);
+		}
+		free(ownedBytes);
+		mappedBytes = nullptr;
+		mappedLength = 0;
+		ownedBytes = nullptr;
+		setLayout(nullptr, 0, 0, 0);
+	}
+
+	bool isLoaded() const { return data != nullptr; }
+
+	uint32_t getTableLength() const { return tableLength; }
+	uint32_t getTableMask() const { return mask; }
+	uint32_t getOctaveCount() const { return octaveCount; }
+	uint32_t getFrameCount() const { return frameCount; }
+
+	float const* table(uint32_t frame, uint32_t octave) const {
+		return data + tableOffset(frame, octave);
+	}
+
+	// The lowest octave whose harmonics all stay below Nyquist at this phase increment (cycles per sample).
+	uint32_t octaveForIncrement(double increment) const {
+		uint32_t octave = 0;
+		while (octave + 1 < octaveCount && harmonicsForOctave(octave) * increment > 0.5) {
+			++octave;
+		}
+		return octave;
+	}
+
+private:
+	float const* data = nullptr;
+	uint32_t tableLength = 0;
+	uint32_t mask = 0;
+	uint32_t octaveCount = 0;
+	uint32_t frameCount = 0;
+
+	void* mappedBytes = nullptr;
+	size_t mappedLength = 0;
+	float* ownedBytes = nullptr;
+
+	static bool isValidLayout(uint32_t length, uint32_t octaves, uint32_t frames) {
+		bool const powerOfTwo = length != 0 && (length & (length - 1)) == 0;
+		// Octave n holds length / 2^(n + 1) harmonics, so there is no point going past a single harmonic.
+		uint32_t maximumOctaves = 0;
+		while ((length >> (maximumOctaves + 1)) > 0) {
+			++maximumOctaves;
+		}
+		return powerOfTwo
+			&& length >= kMinimumTableLength
+			&& length <= kMaximumTableLength
+			&& octaves > 0
+			&& octaves <= maximumOctaves
+			&& frames > 0;
+	}
+
+	static size_t dataSize(uint32_t length, uint32_t octaves, uint32_t frames) {
+		return (size_t)length * octaves * frames * sizeof(float);
+	}
+
+	void setLayout(float const* newData, uint32_t length, uint32_t octaves, uint32_t frames) {
+		data = newData;
+		tableLength = length;
+		mask = length > 0 ? length - 1 : 0;
+		octaveCount = octaves;
+		frameCount = frames;
+	}
+
+	size_t tableOffset(uint32_t frame, uint32_t octave) const {
+		return ((size_t)frame * octaveCount + octave) * tableLength;
+	}
+
+	uint32_t harmonicsForOctave(uint32_t octave) const {
+		return (tableLength / 2) >> octave;
+	}
+};
+
+static_assert(sizeof(BasicSynth2WavetableBank::FileHeader) == BasicSynth2WavetableBank::kAlignment, "Keep the first table cache-line aligned");
+
+
+// MARK: - BasicSynth2WavetableOscillator
+/*
+ BasicSynth2WavetableOscillator
+
+ Reads a bank with linear interpolation. The octave and the two frames being morphed between are
+ picked once per block by prepare(), so the per-sample work is one interpolated read per frame
+ (and only one when the position sits exactly on a frame).
+ */
+struct BasicSynth2WavetableOscillator {
+	double phase = 0;
+	double increment = 0;
+
+	float const* tableA = nullptr;
+	float const* tableB = nullptr;
+	float morph = 0;
+	uint32_t mask = 0;
+	float length = 0;
+
+	void reset() {
+		phase = 0;
+	}
+
+	// position is 0...1 across the bank's frames.
+	bool prepare(BasicSynth2WavetableBank const* bank, float frequency, float sampleRate, float position) {
+		if (bank == nullptr || !bank->isLoaded() || sampleRate <= 0) {
+			tableA = nullptr;
+			return false;
+		}
+
+		increment = frequency / sampleRate;
+		uint32_t const octave = bank->octaveForIncrement(increment);
+
+		float const framePosition = std::min(std::max(position, 0.0f), 1.0f) * (float)(bank->getFrameCount() - 1);
+		uint32_t const frameA = (uint32_t)framePosition;
+		uint32_t const frameB = std::min(frameA + 1, bank->getFrameCount() - 1);
+
+		tableA = bank->table(frameA, octave);
+		tableB = bank->table(frameB, octave);
+		morph = (frameB == frameA) ? 0.0f : framePosition - (float)frameA;
+		mask = bank->getTableMask();
+		length = (float)bank->getTableLength();
+		return true;
+	}
+
+	float compute() {
+		float const index = (float)(phase * length);
+		uint32_t const i0 = (uint32_t)index;
+		float const fraction = index - (float)i0;
+		uint32_t const a = i0 & mask;
+		uint32_t const b = (i0 + 1) & mask;
+
+		float sample = tableA[a] + fraction * (tableA[b] - tableA[a]);
+		if (morph != 0) {
+			float const other = tableB[a] + fraction * (tableB[b] - tableB[a]);
+			sample += morph * (other - sample);
+		}
+
+		phase += increment;
+		if (phase >= 1.0) {
+			phase -= 1.0;
+		}
+		return sample;
+	}
+};
+
+#endif /* BasicSynth2Wavetable_hpp */
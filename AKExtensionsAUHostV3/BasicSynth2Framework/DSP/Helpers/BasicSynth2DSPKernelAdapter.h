@@ -30,6 +30,19 @@ NS_ASSUME_NONNULL_BEGIN
 - (void)setParameter:(AUParameter *)parameter value:(AUValue)value;
 - (AUValue)valueForParameter:(AUParameter *)parameter;
 
+// Preset snapshots: the whole parameter set as one compact binary blob, applied atomically on the render thread.
+- (NSData *)presetSnapshot;
+- (BOOL)loadPresetSnapshot:(NSData *)snapshot rampFrames:(AUAudioFrameCount)rampFrames;
+
+// Preset banks are memory-mapped; selecting an entry reads it straight out of the mapping.
+@property (readonly) NSUInteger presetBankCount;
+- (BOOL)openPresetBankAtPath:(NSString *)path;
+- (BOOL)selectPresetBankEntry:(NSUInteger)index rampFrames:(AUAudioFrameCount)rampFrames;
++ (BOOL)writePresetBank:(NSArray<NSData *> *)snapshots toPath:(NSString *)path;
+
+// Wavetable banks are memory-mapped and shared between every instance that opens the same file.
+- (BOOL)loadWavetableBankAtPath:(NSString *)path;
+
 - (void)allocateRenderResources;
 - (void)deallocateRenderResources;
 - (AUInternalRenderBlock)internalRenderBlock;
@@ -24,6 +24,7 @@
 	// C++ members need to be ivars; they would be copied on access if they were properties.
 	BasicSynth2DSPKernel _kernel;
 	AUv3BufferedOutputBus _outputBusBuffer;
+	BasicSynth2PresetBank _presetBank;
 }
 
 
@@ -58,11 +59,6 @@
 	return self;
 }
 
-- (void)setKernel:(BasicSynth2DSPKernel) ptr {
-	NSLog(@"Obj-C BasicSynth2DSPKernelAdapter setKernel");
-	_kernel = ptr;
-}
-
 - (void)setParameter:(AUParameter *)parameter value:(AUValue)value {
 	NSLog(@"Obj-C BasicSynth2DSPKernelAdapter setParameter");
 	_kernel.setParameter(parameter.address, value);
@@ -72,6 +68,58 @@
 	return _kernel.getParameter(parameter.address);
 }
 
+#pragma mark - Preset Snapshots
+
+- (NSData *)presetSnapshot {
+	BasicSynth2PresetSnapshot snapshot;
+	_kernel.captureSnapshot(snapshot);
+	return [NSData dataWithBytes:&snapshot length:sizeof(snapshot)];
+}
+
+- (BOOL)loadPresetSnapshot:(NSData *)snapshot rampFrames:(AUAudioFrameCount)rampFrames {
+	if (snapshot.length != sizeof(BasicSynth2PresetSnapshot)) {
+		return NO;
+	}
+	BasicSynth2PresetSnapshot value;
+	memcpy(&value, snapshot.bytes, sizeof(value));
+	return _kernel.publishSnapshot(value, rampFrames);
+}
+
+- (NSUInteger)presetBankCount {
+	return _presetBank.size();
+}
+
+- (BOOL)openPresetBankAtPath:(NSString *)path {
+	return _presetBank.open(path.fileSystemRepresentation);
+}
+
+- (BOOL)selectPresetBankEntry:(NSUInteger)index rampFrames:(AUAudioFrameCount)rampFrames {
+	BasicSynth2PresetSnapshot const *snapshot = _presetBank.entry((uint32_t)index);
+	if (snapshot == nullptr) {
+		return NO;
+	}
+	return _kernel.publishSnapshot(*snapshot, rampFrames);
+}
+
++ (BOOL)writePresetBank:(NSArray<NSData *> *)snapshots toPath:(NSString *)path {
+	NSMutableData *entries = [NSMutableData dataWithCapacity:snapshots.count * sizeof(BasicSynth2PresetSnapshot)];
+	for (NSData *snapshot in snapshots) {
+		if (snapshot.length != sizeof(BasicSynth2PresetSnapshot)) {
+			return NO;
+		}
+		[entries appendData:snapshot];
+	}
+	return BasicSynth2PresetBank::write(path.fileSystemRepresentation,
+										(BasicSynth2PresetSnapshot const *)entries.bytes,
+										(uint32_t)snapshots.count);
+}
+
+#pragma mark - Wavetables
+
+- (BOOL)loadWavetableBankAtPath:(NSString *)path {
+	return _kernel.loadWavetableBank(path.fileSystemRepresentation);
+}
+
 - (AUAudioFrameCount)maximumFramesToRender {
 	return _kernel.maximumFramesToRender();
 }
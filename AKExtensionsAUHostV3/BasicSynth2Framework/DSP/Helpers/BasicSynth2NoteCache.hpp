@@ -0,0 +1,458 @@
+//
+//  BasicSynth2NoteCache.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2NoteCache_hpp
+#define BasicSynth2NoteCache_hpp
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BasicSynth2DSPKernel.hpp"
+
+// MARK: - BasicSynth2NoteCache
+/*
+ BasicSynth2NoteCache
+
+ Memoized note renders for offline bounces.
+
+ Offline renders of sequenced material play the same note, at the same velocity, for the same length,
+ with the same patch, over and over. With BasicSynth2DSPKernel::resetVoiceOnAttack set, a note that
+ starts from silence is a pure function of those four things, so its output only needs rendering once.
+
+ The cache is bounded by the bytes of audio it holds and evicts the least recently used note first.
+ */
+
+struct BasicSynth2NoteKey {
+	uint8_t note = 0;
+	uint8_t velocity = 0;
+	uint32_t gateFrames = 0;
+	uint64_t stateHash = 0;		// BasicSynth2DSPKernel::renderStateHash() at the note on
+
+	bool operator==(BasicSynth2NoteKey const& other) const {
+		return note == other.note
+			&& velocity == other.velocity
+			&& gateFrames == other.gateFrames
+			&& stateHash == other.stateHash;
+	}
+};
+
+struct BasicSynth2NoteKeyHash {
+	size_t operator()(BasicSynth2NoteKey const& key) const {
+		uint64_t hash = key.stateHash;
+		hash ^= ((uint64_t)key.note << 40) | ((uint64_t)key.velocity << 32) | key.gateFrames;
+		hash *= 0x9E3779B97F4A7C15ull;
+		return (size_t)(hash ^ (hash >> 29));
+	}
+};
+
+
+struct BasicSynth2NoteCacheStatistics {
+	uint64_t lookups = 0;
+	uint64_t hits = 0;
+	uint64_t insertions = 0;
+	uint64_t evictions = 0;
+	size_t entryCount = 0;
+	size_t bytesUsed = 0;
+
+	double hitRate() const {
+		return lookups > 0 ? (double)hits / (double)lookups : 0.0;
+	}
+};
+
+
+class BasicSynth2NoteCache {
+public:
+	struct Entry {
+		BasicSynth2NoteKey key;
+		std::vector<float> left;
+		std::vector<float> right;
+
+		AUAudioFrameCount frameCount() const { return (AUAudioFrameCount)left.size(); }
+
+		size_t bytes() const {
+			return sizeof(Entry) + (left.capacity() + right.capacity()) * sizeof(float);
+		}
+	};
+
+	explicit BasicSynth2NoteCache(size_t capacityBytes = 64 << 20) : capacity(capacityBytes) {}
+
+	BasicSynth2NoteCache(BasicSynth2NoteCache const&) = delete;
+	BasicSynth2NoteCache& operator=(BasicSynth2NoteCache const&) = delete;
+
+	// Counts as a lookup for the hit rate, and marks the entry as most recently used.
+	Entry const* find(BasicSynth2NoteKey const& key) {
+		++stats.lookups;
+		auto found = index.find(key);
+		if (found == index.end()) {
+			return nullptr;
+		}
+		++stats.hits;
+		entries.splice(entries.begin(), entries, found->second);
+		return &*found->second;
+	}
+
+	// Takes ownership of the rendered audio. Notes bigger than the whole cache aren't kept.
+	bool insert(BasicSynth2NoteKey const& key, std::vector<float>&& left, std::vector<float>&& right) {
+		left.shrink_to_fit();
+		right.shrink_to_fit();
+
+		Entry entry;
+		entry.key = key;
+		entry.left = std::move(left);
+		entry.right = std::move(right);
+		size_t const bytes = entry.bytes();
+		if (bytes > capacity) {
+			return false;
+		}
+
+		erase(key);
+		while (stats.bytesUsed + bytes > capacity && !entries.empty()) {
+			erase(entries.back().key);
+			++stats.evictions;
+		}
+
+		entries.push_front(std::move(entry));
+		index[key] = entries.begin();
+		stats.bytesUsed += bytes;
+		stats.entryCount = entries.size();
+		++stats.insertions;
+		return true;
+	}
+
+	void clear() {
+		entries.clear();
+		index.clear();
+		stats.bytesUsed = 0;
+		stats.entryCount = 0;
+	}
+
+	void setCapacity(size_t capacityBytes) {
+		capacity = capacityBytes;
+		while (stats.bytesUsed > capacity && !entries.empty()) {
+			erase(entries.back().key);
+			++stats.evictions;
+		}
+	}
+
+	size_t getCapacity() const { return capacity; }
+
+	BasicSynth2NoteCacheStatistics const& statistics() const { return stats; }
+
+	void printStatistics() const {
+		std::cout << "Note cache: " << stats.hits << "/" << stats.lookups << " hits ("
+				  << stats.hitRate() * 100.0 << "%), "
+				  << stats.entryCount << " notes, "
+				  << stats.bytesUsed / 1024 << " of " << capacity / 1024 << " KiB, "
+				  << stats.evictions << " evicted" << std::endl;
+	}
+
+private:
+	std::list<Entry> entries;	// most recently used first
+	std::unordered_map<BasicSynth2NoteKey, std::list<Entry>::iterator, BasicSynth2NoteKeyHash> index;
+	size_t capacity;
+	BasicSynth2NoteCacheStatistics stats;
+
+	void erase(BasicSynth2NoteKey const& key) {
+		auto found = index.find(key);
+		if (found == index.end()) {
+			return;
+		}
+		stats.bytesUsed -= found->second->bytes();
+		entries.erase(found->second);
+		index.erase(found);
+		stats.entryCount = entries.size();
+	}
+};
+
+
+// MARK: - BasicSynth2CachedRenderer
+/*
+ BasicSynth2CachedRenderer
+
+ Drives a BasicSynth2DSPKernel through an offline bounce, serving notes from a BasicSynth2NoteCache where
+ it can and filling the cache with the notes it renders live. The caller owns the kernel (initialized, with
+ its patch set) and the cache, so an adapter or a render-block bounce can keep both across bounces.
+
+ schedule() hands over the whole bounce's events up front, so a note's gate length is known at its note on;
+ render() then pulls the bounce in calls of any length, the way a host pulls a render block. A note is
+ served from the cache only if it starts from silence, no parameter is ramping, and nothing but note offs
+ happens until the cached audio ends; otherwise it is rendered live. In the same way, a live note is only
+ stored if nothing but note offs happened while it sounded and the voice went silent before the next
+ note on. Any parameter change mid-note therefore means the note is rendered live.
+
+ The effect bus carries sound from one note into the next, so nothing is cached while it has a tail.
+
+ The kernel (BasicSynth2DSPKernel is monophonic) isn't run while cached audio plays, so a cache hit
+ costs a copy. Cached notes end when the kernel turns the voice off, on a render segment boundary,
+ so the output matches a live render up to the near-silent tail after that point.
+
+ Not thread safe: one renderer per cache at a time, on one thread.
+ */
+
+class BasicSynth2CachedRenderer {
+public:
+	BasicSynth2CachedRenderer(BasicSynth2DSPKernel& kernel, BasicSynth2NoteCache& cache)
+		: kernel(kernel), cache(cache) {
+		kernel.resetVoiceOnAttack = true;
+		scratchLeft.resize(kernel.maximumFramesToRender());
+		scratchRight.resize(kernel.maximumFramesToRender());
+	}
+
+	BasicSynth2CachedRenderer(BasicSynth2CachedRenderer const&) = delete;
+	BasicSynth2CachedRenderer& operator=(BasicSynth2CachedRenderer const&) = delete;
+
+	// Starts a bounce at frame 0. Event times are frames from the start of the bounce.
+	void schedule(std::vector<AURenderEvent> bounceEvents) {
+		events = std::move(bounceEvents);
+		std::stable_sort(events.begin(), events.end(), [](AURenderEvent const& a, AURenderEvent const& b) {
+			return a.head.eventSampleTime < b.head.eventSampleTime;
+		});
+		nextEvent = 0;
+		position = 0;
+		playing = nullptr;
+		recording.active = false;
+	}
+
+	// The next frameCount frames of the bounce, mixed into left and right, which must be zeroed.
+	void render(AUAudioFrameCount frameCount, float* left, float* right) {
+		AUAudioFrameCount const callStart = position;
+		AUAudioFrameCount const callEnd = position + frameCount;
+
+		while (position < callEnd) {
+			if (playing == nullptr) {
+				startNote();
+			}
+
+			if (playing != nullptr) {
+				AUAudioFrameCount const end = std::min(playingStart + playing->frameCount(), callEnd);
+				for (AUAudioFrameCount i = position; i < end; ++i) {
+					left[i - callStart] += playing->left[i - playingStart];
+					right[i - callStart] += playing->right[i - playingStart];
+				}
+				kernel.skipIdleFrames(end - position);
+				while (nextEvent < events.size() && events[nextEvent].head.eventSampleTime < (AUEventSampleTime)end) {
+					++nextEvent;
+				}
+				position = end;
+				if (position == playingStart + playing->frameCount()) {
+					playing = nullptr;
+				}
+				continue;
+			}
+
+			renderLive(callEnd, left + (position - callStart), right + (position - callStart));
+		}
+	}
+
+	AUAudioFrameCount framePosition() const { return position; }
+
+private:
+	struct Recording {
+		bool active = false;
+		BasicSynth2NoteKey key;
+		AUAudioFrameCount startFrame = 0;
+		int channel = 0;
+		std::vector<float> left;
+		std::vector<float> right;
+
+		void start(BasicSynth2NoteKey const& noteKey, AUAudioFrameCount frame, int noteChannel) {
+			active = true;
+			key = noteKey;
+			startFrame = frame;
+			channel = noteChannel;
+			left.clear();
+			right.clear();
+		}
+	};
+
+	BasicSynth2DSPKernel& kernel;
+	BasicSynth2NoteCache& cache;
+	std::vector<AURenderEvent> events;
+	size_t nextEvent = 0;
+	AUAudioFrameCount position = 0;
+
+	// The cache hit being played, which started at playingStart. Nothing is inserted while it plays,
+	// so the entry stays put.
+	BasicSynth2NoteCache::Entry const* playing = nullptr;
+	AUAudioFrameCount playingStart = 0;
+
+	Recording recording;
+	std::vector<float> scratchLeft;
+	std::vector<float> scratchRight;
+
+	// At a note on that starts from silence: play it from the cache, or start recording it.
+	void startNote() {
+		if (nextEvent >= events.size()
+			|| events[nextEvent].head.eventSampleTime > (AUEventSampleTime)position
+			|| !isNoteOn(events[nextEvent])
+			|| kernel.isVoiceActive()
+			|| kernel.hasEffectTail()) {
+			return;
+		}
+
+		AUMIDIEvent const& noteOn = events[nextEvent].MIDI;
+		AUAudioFrameCount const gate = gateFrames(nextEvent);
+
+		recording.active = false;
+		if (gate == 0 || !kernel.parametersSettled()) {
+			return;
+		}
+
+		BasicSynth2NoteKey key;
+		key.note = noteOn.data[1];
+		key.velocity = noteOn.data[2];
+		key.gateFrames = gate;
+		key.stateHash = kernel.renderStateHash(noteOn.data[0] & 0x0F);
+
+		if (BasicSynth2NoteCache::Entry const* entry = cache.find(key)) {
+			if (onlyNoteOffsUntil(nextEvent + 1, position + entry->frameCount(), key.note)) {
+				playing = entry;
+				playingStart = position;
+			}
+		} else {
+			recording.start(key, position, noteOn.data[0] & 0x0F);
+		}
+	}
+
+	// One render call into the kernel, up to end or the kernel's maximum, stopping early at a note on
+	// so it gets the check in startNote().
+	void renderLive(AUAudioFrameCount end, float* left, float* right) {
+		AUAudioFrameCount segmentEnd = std::min(end, position + (AUAudioFrameCount)scratchLeft.size());
+		for (size_t i = nextEvent; i < events.size() && events[i].head.eventSampleTime < (AUEventSampleTime)segmentEnd; ++i) {
+			if (events[i].head.eventSampleTime > (AUEventSampleTime)position && isNoteOn(events[i])) {
+				segmentEnd = (AUAudioFrameCount)events[i].head.eventSampleTime;
+				break;
+			}
+		}
+		AUAudioFrameCount const frames = segmentEnd - position;
+
+		size_t const firstEvent = nextEvent;
+		AURenderEvent const* head = linkEvents(segmentEnd);
+		if (recording.active) {
+			for (size_t i = firstEvent; i < nextEvent; ++i) {
+				bool const ownNoteOn = (AUAudioFrameCount)events[i].head.eventSampleTime == recording.startFrame && isNoteOn(events[i]);
+				if (!ownNoteOn && !isNoteOff(events[i], recording.key.note)) {
+					recording.active = false;
+				}
+			}
+		}
+
+		std::fill(scratchLeft.begin(), scratchLeft.begin() + frames, 0.0f);
+		std::fill(scratchRight.begin(), scratchRight.begin() + frames, 0.0f);
+		processWithEvents(head, frames);
+
+		for (AUAudioFrameCount i = 0; i < frames; ++i) {
+			left[i] += scratchLeft[i];
+			right[i] += scratchRight[i];
+		}
+		if (recording.active) {
+			recording.left.insert(recording.left.end(), scratchLeft.begin(), scratchLeft.begin() + frames);
+			recording.right.insert(recording.right.end(), scratchRight.begin(), scratchRight.begin() + frames);
+		}
+		position = segmentEnd;
+
+		// The note has died away: keep it, unless the patch moved underneath it.
+		if (recording.active && !kernel.isVoiceActive()) {
+			recording.active = false;
+			if (kernel.parametersSettled()
+				&& !kernel.hasEffectTail()
+				&& kernel.renderStateHash(recording.channel) == recording.key.stateHash) {
+				cache.insert(recording.key, std::move(recording.left), std::move(recording.right));
+			}
+		}
+	}
+
+	// Links up the events before end the way the host hands them to the render block. Late events move to position.
+	AURenderEvent const* linkEvents(AUAudioFrameCount end) {
+		AURenderEvent* head = nullptr;
+		AURenderEvent* tail = nullptr;
+		while (nextEvent < events.size() && events[nextEvent].head.eventSampleTime < (AUEventSampleTime)end) {
+			AURenderEvent* event = &events[nextEvent++];
+			event->head.eventSampleTime = std::max<AUEventSampleTime>(event->head.eventSampleTime, position);
+			event->head.next = nullptr;
+			if (tail != nullptr) {
+				tail->head.next = event;
+			} else {
+				head = event;
+			}
+			tail = event;
+		}
+		return head;
+	}
+
+	void processWithEvents(AURenderEvent const* head, AUAudioFrameCount frames) {
+		uint8_t bufferListStorage[offsetof(AudioBufferList, mBuffers) + 2 * sizeof(AudioBuffer)];
+		AudioBufferList* bufferList = (AudioBufferList*)bufferListStorage;
+
+		bufferList->mNumberBuffers = 2;
+		float* channels[2] = { scratchLeft.data(), scratchRight.data() };
+		for (UInt32 channel = 0; channel < 2; ++channel) {
+			bufferList->mBuffers[channel].mNumberChannels = 1;
+			bufferList->mBuffers[channel].mDataByteSize = UInt32(frames * sizeof(float));
+			bufferList->mBuffers[channel].mData = channels[channel];
+		}
+
+		AudioTimeStamp timestamp;
+		memset(&timestamp, 0, sizeof(timestamp));
+		timestamp.mSampleTime = position;
+		timestamp.mFlags = kAudioTimeStampSampleTimeValid;
+
+		kernel.setOutputBuffer(bufferList);
+		kernel.processWithEvents(&timestamp, frames, head);
+	}
+
+	static bool isNoteOn(AURenderEvent const& event) {
+		return event.head.eventType == AURenderEventMIDI
+			&& event.MIDI.length == 3
+			&& (event.MIDI.data[0] & 0xF0) == 0x90
+			&& event.MIDI.data[2] != 0;
+	}
+
+	// Whether the event releases the voice while it sounds note, following BasicSynth2DSPKernel: a note off
+	// releases it whatever its note number, a note on with velocity 0 only if the note numbers match.
+	// Any other velocity 0 note on leaves the voice alone, but isn't counted as a note off here.
+	static bool isNoteOff(AURenderEvent const& event, uint8_t note) {
+		if (event.head.eventType != AURenderEventMIDI || event.MIDI.length != 3) {
+			return false;
+		}
+		uint8_t const status = event.MIDI.data[0] & 0xF0;
+		return status == 0x80 || (status == 0x90 && event.MIDI.data[2] == 0 && event.MIDI.data[1] == note);
+	}
+
+	// Frames from the note on at noteOnIndex to the note off that releases it,
+	// or 0 if another note on or the end of the list comes first.
+	AUAudioFrameCount gateFrames(size_t noteOnIndex) const {
+		for (size_t i = noteOnIndex + 1; i < events.size(); ++i) {
+			if (isNoteOn(events[i])) {
+				return 0;
+			}
+			if (isNoteOff(events[i], events[noteOnIndex].MIDI.data[1])) {
+				return (AUAudioFrameCount)(events[i].head.eventSampleTime - events[noteOnIndex].head.eventSampleTime);
+			}
+		}
+		return 0;
+	}
+
+	bool onlyNoteOffsUntil(size_t first, AUAudioFrameCount end, uint8_t note) const {
+		for (size_t i = first; i < events.size() && events[i].head.eventSampleTime < (AUEventSampleTime)end; ++i) {
+			if (!isNoteOff(events[i], note)) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+#endif /* BasicSynth2NoteCache_hpp */
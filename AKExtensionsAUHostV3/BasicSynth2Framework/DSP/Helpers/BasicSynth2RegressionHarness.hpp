@@ -0,0 +1,1158 @@
+//
+//  BasicSynth2RegressionHarness.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2RegressionHarness_hpp
+#define BasicSynth2RegressionHarness_hpp
+
+#include <algorithm>
+#include <cfenv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BasicSynth2DSPKernel.hpp"
+#include "BasicSynth2KernelGroup.hpp"
+#include "BasicSynth2NoteCache.hpp"
+
+// MARK: - BasicSynth2RegressionHarness
+/*
+ BasicSynth2RegressionHarness
+
+ Offline golden-output checks for BasicSynth2DSPKernel.
+
+ Each scenario is rendered through processWithEvents() exactly like the AU render block does it
+ (same block size, same event list), with no audio device involved, and the result is compared
+ against a reference file recorded from a known-good build.
+
+ Bit-exact mode is for refactors that shouldn't change a single sample. Tolerance mode
+ (max absolute error + SNR) is for changes like vectorization that are allowed to round differently.
+
+ BasicSynth2KernelGroup renders the same voice its own way, so it is checked against the kernel, not
+ the references, and by level rather than sample for sample: see compareLevels().
+
+ The Regression directory next to DSP builds this on Linux or macOS against stand-ins for AudioKit and
+ AudioToolbox, with a runner and the recorded references.
+ */
+
+struct BasicSynth2RegressionScenario {
+	std::string name;
+	double sampleRate = 44100.0;
+	AUAudioFrameCount frameCount = 0;
+	AUAudioFrameCount blockSize = 512;
+
+	// 1 renders into a single buffer, the way a mono output bus does. References keep it on both channels.
+	uint32_t channelCount = 2;
+
+	// Applied as immediate ramps before the first block.
+	std::vector<std::pair<AUParameterAddress, AUValue>> initialParameters;
+
+	// Absolute sample times, in order.
+	std::vector<AURenderEvent> events;
+
+	// Frames at which the host reallocates render resources at a new sample rate, in order.
+	std::vector<std::pair<AUAudioFrameCount, double>> sampleRateChanges;
+
+	// Frames at which the UI publishes a preset, in order. Only the addresses listed change.
+	struct Snapshot {
+		AUAudioFrameCount frame;
+		std::vector<std::pair<AUParameterAddress, AUValue>> values;
+		AUAudioFrameCount rampFrames;
+	};
+	std::vector<Snapshot> snapshots;
+
+	BasicSynth2RegressionScenario& parameter(AUParameterAddress address, AUValue value) {
+		initialParameters.push_back(std::make_pair(address, value));
+		return *this;
+	}
+
+	BasicSynth2RegressionScenario& noteOn(AUEventSampleTime time, uint8_t note, uint8_t velocity) {
+		return midi(time, 0x90, note, velocity);
+	}
+
+	BasicSynth2RegressionScenario& noteOff(AUEventSampleTime time, uint8_t note) {
+		return midi(time, 0x80, note, 0);
+	}
+
+	// Any three byte channel message; the status byte carries the channel.
+	BasicSynth2RegressionScenario& midi(AUEventSampleTime time, uint8_t status, uint8_t data1, uint8_t data2) {
+		AURenderEvent event;
+		memset(&event, 0, sizeof(event));
+		event.MIDI.eventSampleTime = time;
+		event.MIDI.eventType = AURenderEventMIDI;
+		event.MIDI.length = 3;
+		event.MIDI.data[0] = status;
+		event.MIDI.data[1] = data1;
+		event.MIDI.data[2] = data2;
+		events.push_back(event);
+		return *this;
+	}
+
+	// Between two render calls, the way the adapter does it: deallocate, then allocate at the new rate.
+	BasicSynth2RegressionScenario& sampleRateChange(AUAudioFrameCount frame, double newSampleRate) {
+		sampleRateChanges.push_back(std::make_pair(frame, newSampleRate));
+		return *this;
+	}
+
+	// Published from the UI thread between two render calls, on top of the parameters the UI has at that point.
+	BasicSynth2RegressionScenario& snapshot(AUAudioFrameCount frame, std::vector<std::pair<AUParameterAddress, AUValue>> const& values,
+											AUAudioFrameCount rampFrames) {
+		snapshots.push_back(Snapshot { frame, values, rampFrames });
+		return *this;
+	}
+
+	BasicSynth2RegressionScenario& ramp(AUEventSampleTime time, AUParameterAddress address, AUValue value, AUAudioFrameCount duration) {
+		AURenderEvent event;
+		memset(&event, 0, sizeof(event));
+		event.parameter.eventSampleTime = time;
+		event.parameter.eventType = duration > 0 ? AURenderEventParameterRamp : AURenderEventParameter;
+		event.parameter.parameterAddress = address;
+		event.parameter.value = value;
+		event.parameter.rampDurationSampleFrames = duration;
+		events.push_back(event);
+		return *this;
+	}
+};
+
+
+struct BasicSynth2RenderedAudio {
+	double sampleRate = 0;
+	std::vector<float> left;
+	std::vector<float> right;
+};
+
+
+struct BasicSynth2ComparisonResult {
+	bool passed = false;
+	bool lengthMismatch = false;
+	size_t mismatchedSamples = 0;
+	size_t firstMismatch = 0;
+	double maxAbsoluteError = 0;
+	double snrDecibels = std::numeric_limits<double>::infinity();
+};
+
+
+struct BasicSynth2RegressionOptions {
+	enum Mode { BitExact, Tolerance };
+
+	Mode mode = BitExact;
+	double maxAbsoluteError = 1.0e-5;
+	double minimumSnrDecibels = 100.0;
+
+	// Write fresh reference files instead of comparing against them.
+	bool record = false;
+
+	// Kernel group against kernel: windows of groupWindowFrames whose levels may differ by
+	// groupLevelToleranceDecibels, counting only windows within groupLevelRangeDecibels of the loudest.
+	AUAudioFrameCount groupWindowFrames = 2048;
+	double groupLevelToleranceDecibels = 1.0;
+	double groupLevelRangeDecibels = 40.0;
+	uint32_t groupInstances = 11;
+};
+
+
+struct BasicSynth2LevelComparison {
+	bool passed = false;
+	bool instancesDiffer = false;
+	size_t windows = 0;
+	size_t worstWindow = 0;
+	double worstDifferenceDecibels = 0;
+};
+
+
+class BasicSynth2RegressionHarness {
+public:
+
+	// MARK: - Rendering
+
+	// afterBlock, if set, gets to look at the kernel after every render call, with the frame the call ended at.
+	static BasicSynth2RenderedAudio render(BasicSynth2RegressionScenario const& scenario,
+										   std::function<void(BasicSynth2DSPKernel const&, AUAudioFrameCount)> const& afterBlock = nullptr) {
+		BasicSynth2RenderedAudio audio;
+		audio.sampleRate = scenario.sampleRate;
+		audio.left.assign(scenario.frameCount, 0.0f);
+		audio.right.assign(scenario.frameCount, 0.0f);
+
+		std::unique_ptr<BasicSynth2DSPKernel> kernel = makeKernel(scenario);
+		std::vector<AURenderEvent> events = sortedEvents(scenario);
+
+		size_t nextEvent = 0;
+		size_t nextRateChange = 0;
+		size_t nextSnapshot = 0;
+		AUAudioFrameCount const blockSize = std::max<AUAudioFrameCount>(scenario.blockSize, 1);
+
+		for (AUAudioFrameCount blockStart = 0, frames = 0; blockStart < scenario.frameCount; blockStart += frames) {
+			AUAudioFrameCount blockEnd = std::min(blockStart + blockSize, scenario.frameCount);
+			while (nextRateChange < scenario.sampleRateChanges.size()
+				   && scenario.sampleRateChanges[nextRateChange].first <= blockStart) {
+				reallocate(*kernel, scenario.channelCount, scenario.sampleRateChanges[nextRateChange++].second);
+			}
+			while (nextSnapshot < scenario.snapshots.size()
+				   && scenario.snapshots[nextSnapshot].frame <= blockStart) {
+				publishSnapshot(*kernel, scenario.snapshots[nextSnapshot++]);
+			}
+			// A block never straddles a rate change or a snapshot.
+			if (nextRateChange < scenario.sampleRateChanges.size()) {
+				blockEnd = std::min(blockEnd, scenario.sampleRateChanges[nextRateChange].first);
+			}
+			if (nextSnapshot < scenario.snapshots.size()) {
+				blockEnd = std::min(blockEnd, scenario.snapshots[nextSnapshot].frame);
+			}
+
+			frames = blockEnd - blockStart;
+			AURenderEvent const* head = linkEvents(events, nextEvent, blockStart, blockEnd);
+			renderSegment(*kernel, head, blockStart, frames, &audio.left[blockStart],
+						  scenario.channelCount > 1 ? &audio.right[blockStart] : nullptr);
+			if (afterBlock) {
+				afterBlock(*kernel, blockEnd);
+			}
+		}
+
+		if (scenario.channelCount == 1) {
+			audio.right = audio.left;
+		}
+		return audio;
+	}
+
+	// A fresh kernel with the scenario's starting parameters applied.
+	static std::unique_ptr<BasicSynth2DSPKernel> makeKernel(BasicSynth2RegressionScenario const& scenario) {
+		// The kernel is large and owns Soundpipe state, so every scenario gets a fresh one.
+		std::unique_ptr<BasicSynth2DSPKernel> kernel(new BasicSynth2DSPKernel());
+		kernel->init((int)scenario.channelCount, scenario.sampleRate);
+		kernel->reset();
+
+		// Same starting point as BasicSynth2DSPKernelAdapter.
+		kernel->startRamp(FilterCutoffFrequencyAddress, 11025.0f, 0);
+		kernel->startRamp(PulseWidthAddress, 0.5f, 0);
+		for (auto const& parameter : scenario.initialParameters) {
+			kernel->startRamp(parameter.first, parameter.second, 0);
+		}
+		return kernel;
+	}
+
+	// What BasicSynth2DSPKernelAdapter's deallocateRenderResources and allocateRenderResources do.
+	static void reallocate(BasicSynth2DSPKernel& kernel, uint32_t channelCount, double sampleRate) {
+		kernel.destroy();
+		kernel.init((int)channelCount, sampleRate);
+		kernel.reset();
+	}
+
+	// The scenario bounced through BasicSynth2CachedRenderer, a render call of blockSize frames at a time.
+	static BasicSynth2RenderedAudio renderCached(BasicSynth2RegressionScenario const& scenario, BasicSynth2NoteCache& cache) {
+		BasicSynth2RenderedAudio audio;
+		audio.sampleRate = scenario.sampleRate;
+		audio.left.assign(scenario.frameCount, 0.0f);
+		audio.right.assign(scenario.frameCount, 0.0f);
+
+		AUAudioFrameCount const blockSize = std::max<AUAudioFrameCount>(scenario.blockSize, 1);
+		std::unique_ptr<BasicSynth2DSPKernel> kernel = makeKernel(scenario);
+		kernel->setMaximumFramesToRender(blockSize);
+
+		BasicSynth2CachedRenderer renderer(*kernel, cache);
+		renderer.schedule(scenario.events);
+		for (AUAudioFrameCount blockStart = 0; blockStart < scenario.frameCount; blockStart += blockSize) {
+			AUAudioFrameCount const frames = std::min(blockSize, scenario.frameCount - blockStart);
+			renderer.render(frames, &audio.left[blockStart], &audio.right[blockStart]);
+		}
+		return audio;
+	}
+
+	// What the UI does when the user picks a preset: everything as it is, apart from the preset's values.
+	static void publishSnapshot(BasicSynth2DSPKernel& kernel, BasicSynth2RegressionScenario::Snapshot const& snapshot) {
+		BasicSynth2PresetSnapshot values;
+		kernel.captureSnapshot(values);
+		for (auto const& parameter : snapshot.values) {
+			values.values[parameter.first] = parameter.second;
+		}
+		kernel.publishSnapshot(values, snapshot.rampFrames);
+	}
+
+	static std::vector<AURenderEvent> sortedEvents(BasicSynth2RegressionScenario const& scenario) {
+		std::vector<AURenderEvent> events = scenario.events;
+		std::stable_sort(events.begin(), events.end(), [](AURenderEvent const& a, AURenderEvent const& b) {
+			return a.head.eventSampleTime < b.head.eventSampleTime;
+		});
+		return events;
+	}
+
+	// Links up the events before end, starting at nextEvent, the way the host hands them to the render block.
+	// Events that are already late are moved to start.
+	static AURenderEvent const* linkEvents(std::vector<AURenderEvent>& events, size_t& nextEvent,
+										   AUEventSampleTime start, AUEventSampleTime end) {
+		AURenderEvent* head = nullptr;
+		AURenderEvent* tail = nullptr;
+		while (nextEvent < events.size() && events[nextEvent].head.eventSampleTime < end) {
+			AURenderEvent* event = &events[nextEvent++];
+			event->head.eventSampleTime = std::max<AUEventSampleTime>(event->head.eventSampleTime, start);
+			event->head.next = nullptr;
+			if (tail != nullptr) {
+				tail->head.next = event;
+			} else {
+				head = event;
+			}
+			tail = event;
+		}
+		return head;
+	}
+
+	// One render call into a pair of channel buffers, or just left if right is nullptr. They must be zeroed
+	// (the kernel mixes into them).
+	static void renderSegment(BasicSynth2DSPKernel& kernel, AURenderEvent const* events,
+							  AUAudioFrameCount start, AUAudioFrameCount frames, float* left, float* right) {
+		uint8_t bufferListStorage[offsetof(AudioBufferList, mBuffers) + 2 * sizeof(AudioBuffer)];
+		AudioBufferList* bufferList = (AudioBufferList*)bufferListStorage;
+
+		bufferList->mNumberBuffers = right != nullptr ? 2 : 1;
+		float* channels[2] = { left, right };
+		for (UInt32 channel = 0; channel < bufferList->mNumberBuffers; ++channel) {
+			bufferList->mBuffers[channel].mNumberChannels = 1;
+			bufferList->mBuffers[channel].mDataByteSize = UInt32(frames * sizeof(float));
+			bufferList->mBuffers[channel].mData = channels[channel];
+		}
+
+		AudioTimeStamp timestamp;
+		memset(&timestamp, 0, sizeof(timestamp));
+		timestamp.mSampleTime = start;
+		timestamp.mFlags = kAudioTimeStampSampleTimeValid;
+
+		kernel.setOutputBuffer(bufferList);
+		kernel.processWithEvents(&timestamp, frames, events);
+	}
+
+	// MARK: - Reference Files
+
+	// Header followed by the left channel then the right channel, as native floats.
+	struct ReferenceHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t channelCount;
+		uint32_t frameCount;
+		double sampleRate;
+	};
+
+	enum {
+		kReferenceMagic = 0x52325342, // 'BS2R'
+		kReferenceVersion = 1
+	};
+
+	static bool writeReference(std::string const& path, BasicSynth2RenderedAudio const& audio) {
+		FILE* file = fopen(path.c_str(), "wb");
+		if (file == nullptr) {
+			return false;
+		}
+
+		ReferenceHeader header = { kReferenceMagic, kReferenceVersion, 2, (uint32_t)audio.left.size(), audio.sampleRate };
+		bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+		ok = ok && fwrite(audio.left.data(), sizeof(float), audio.left.size(), file) == audio.left.size();
+		ok = ok && fwrite(audio.right.data(), sizeof(float), audio.right.size(), file) == audio.right.size();
+		return (fclose(file) == 0) && ok;
+	}
+
+	static bool readReference(std::string const& path, BasicSynth2RenderedAudio& audio) {
+		FILE* file = fopen(path.c_str(), "rb");
+		if (file == nullptr) {
+			return false;
+		}
+
+		ReferenceHeader header;
+		bool ok = fread(&header, sizeof(header), 1, file) == 1
+			&& header.magic == kReferenceMagic
+			&& header.version == kReferenceVersion
+			&& header.channelCount == 2;
+		if (ok) {
+			audio.sampleRate = header.sampleRate;
+			audio.left.resize(header.frameCount);
+			audio.right.resize(header.frameCount);
+			ok = fread(audio.left.data(), sizeof(float), header.frameCount, file) == header.frameCount
+				&& fread(audio.right.data(), sizeof(float), header.frameCount, file) == header.frameCount;
+		}
+		fclose(file);
+		return ok;
+	}
+
+	// MARK: - Comparison
+
+	static BasicSynth2ComparisonResult compare(BasicSynth2RenderedAudio const& reference,
+											   BasicSynth2RenderedAudio const& rendered,
+											   BasicSynth2RegressionOptions const& options) {
+		BasicSynth2ComparisonResult result;
+		if (reference.left.size() != rendered.left.size() || reference.right.size() != rendered.right.size()) {
+			result.lengthMismatch = true;
+			return result;
+		}
+
+		double signalEnergy = 0;
+		double errorEnergy = 0;
+		bool foundMismatch = false;
+
+		std::vector<float> const* expected[2] = { &reference.left, &reference.right };
+		std::vector<float> const* actual[2] = { &rendered.left, &rendered.right };
+
+		for (int channel = 0; channel < 2; ++channel) {
+			for (size_t i = 0; i < expected[channel]->size(); ++i) {
+				float const a = (*expected[channel])[i];
+				float const b = (*actual[channel])[i];
+				bool const identical = memcmp(&a, &b, sizeof(float)) == 0;
+				if (!identical) {
+					if (!foundMismatch || i < result.firstMismatch) {
+						result.firstMismatch = i;
+					}
+					foundMismatch = true;
+					++result.mismatchedSamples;
+				}
+
+				double const error = std::isfinite(b) ? (double)b - (double)a : std::numeric_limits<double>::infinity();
+				result.maxAbsoluteError = std::max(result.maxAbsoluteError, std::fabs(error));
+				signalEnergy += (double)a * (double)a;
+				errorEnergy += error * error;
+			}
+		}
+
+		if (errorEnergy > 0) {
+			result.snrDecibels = signalEnergy > 0 ? 10.0 * std::log10(signalEnergy / errorEnergy) : -std::numeric_limits<double>::infinity();
+		}
+
+		if (options.mode == BasicSynth2RegressionOptions::BitExact) {
+			result.passed = result.mismatchedSamples == 0;
+		} else {
+			result.passed = result.maxAbsoluteError <= options.maxAbsoluteError
+				&& result.snrDecibels >= options.minimumSnrDecibels;
+		}
+		return result;
+	}
+
+	static void printResult(std::string const& name, BasicSynth2ComparisonResult const& result) {
+		if (result.passed) {
+			std::cout << "[PASS] " << name << std::endl;
+			return;
+		}
+
+		std::cout << "[FAIL] " << name << std::endl;
+		if (result.lengthMismatch) {
+			std::cout << "	rendered length differs from the reference" << std::endl;
+			return;
+		}
+		std::cout << "	mismatched samples: " << result.mismatchedSamples
+				  << " (first at frame " << result.firstMismatch << ")" << std::endl;
+		std::cout << "	max absolute error: " << result.maxAbsoluteError << std::endl;
+		std::cout << "	SNR: " << result.snrDecibels << " dB" << std::endl;
+	}
+
+	// MARK: - Suite
+
+	// Renders every scenario and checks (or records) it against <directory>/<name>.bs2r.
+	// Returns false if anything failed or a reference couldn't be read or written.
+	static bool run(std::string const& directory,
+					std::vector<BasicSynth2RegressionScenario> const& scenarios,
+					BasicSynth2RegressionOptions const& options) {
+		bool allPassed = true;
+
+		for (auto const& scenario : scenarios) {
+			std::string const path = directory + "/" + scenario.name + ".bs2r";
+			BasicSynth2RenderedAudio const rendered = render(scenario);
+
+			if (options.record) {
+				bool const written = writeReference(path, rendered);
+				std::cout << (written ? "[RECORDED] " : "[FAIL] could not write ") << path << std::endl;
+				allPassed = allPassed && written;
+				continue;
+			}
+
+			BasicSynth2RenderedAudio reference;
+			if (!readReference(path, reference)) {
+				std::cout << "[FAIL] " << scenario.name << ": missing or unreadable reference " << path << std::endl;
+				allPassed = false;
+				continue;
+			}
+
+			BasicSynth2ComparisonResult const result = compare(reference, rendered, options);
+			printResult(scenario.name, result);
+			allPassed = allPassed && result.passed;
+		}
+
+		return allPassed;
+	}
+
+	// MARK: - Kernel Group
+
+	// Whether BasicSynth2KernelGroup can play the scenario like the kernel: note ons and offs on any channel,
+	// the group's parameters, in stereo, and no sample rate changes or preset snapshots.
+	static bool groupCanRender(BasicSynth2RegressionScenario const& scenario) {
+		if (!scenario.sampleRateChanges.empty() || !scenario.snapshots.empty() || scenario.channelCount != 2) {
+			return false;
+		}
+		for (auto const& parameter : scenario.initialParameters) {
+			if (parameter.first >= (AUParameterAddress)BasicSynth2KernelGroup::kParameterCount) {
+				return false;
+			}
+		}
+		for (auto const& event : scenario.events) {
+			if (event.head.eventType == AURenderEventMIDI) {
+				uint8_t const status = event.MIDI.data[0] & 0xF0;
+				if (status != 0x80 && status != 0x90) {
+					return false;
+				}
+			} else if (event.parameter.parameterAddress >= (AUParameterAddress)BasicSynth2KernelGroup::kParameterCount) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// The scenario played on instanceCount identical instances of one BasicSynth2KernelGroup. The group applies
+	// events at the start of a render call, so calls are split at every event as well as at block boundaries.
+	// Instance 0 goes to both channels; returns false if any other instance came out different from it.
+	static bool renderGroup(BasicSynth2RegressionScenario const& scenario, uint32_t instanceCount, BasicSynth2RenderedAudio& audio) {
+		audio.sampleRate = scenario.sampleRate;
+		audio.left.assign(scenario.frameCount, 0.0f);
+
+		BasicSynth2KernelGroup group;
+		group.allocate(instanceCount, scenario.sampleRate);
+		std::vector<int> instances;
+		for (uint32_t i = 0; i < instanceCount; ++i) {
+			instances.push_back(group.addInstance());
+			for (auto const& parameter : scenario.initialParameters) {
+				group.setParameter(instances.back(), parameter.first, parameter.second);
+			}
+		}
+
+		std::vector<std::vector<float>> buffers(instanceCount, std::vector<float>(scenario.frameCount, 0.0f));
+		std::vector<float*> outputs(instanceCount);
+		std::vector<AURenderEvent> const events = sortedEvents(scenario);
+		size_t nextEvent = 0;
+		AUAudioFrameCount const blockSize = std::max<AUAudioFrameCount>(scenario.blockSize, 1);
+
+		for (AUAudioFrameCount position = 0; position < scenario.frameCount; ) {
+			for (; nextEvent < events.size() && events[nextEvent].head.eventSampleTime <= (AUEventSampleTime)position; ++nextEvent) {
+				for (int instance : instances) {
+					sendToGroup(group, instance, events[nextEvent]);
+				}
+			}
+
+			AUAudioFrameCount end = std::min((position / blockSize + 1) * blockSize, scenario.frameCount);
+			if (nextEvent < events.size()) {
+				end = std::min(end, (AUAudioFrameCount)events[nextEvent].head.eventSampleTime);
+			}
+			for (uint32_t i = 0; i < instanceCount; ++i) {
+				outputs[i] = buffers[i].data() + position;
+			}
+			group.render(end - position, outputs.data());
+			position = end;
+		}
+
+		audio.left = buffers[0];
+		audio.right = buffers[0];
+		for (uint32_t i = 1; i < instanceCount; ++i) {
+			if (memcmp(buffers[i].data(), buffers[0].data(), scenario.frameCount * sizeof(float)) != 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static void sendToGroup(BasicSynth2KernelGroup& group, int instance, AURenderEvent const& event) {
+		if (event.head.eventType == AURenderEventMIDI) {
+			if ((event.MIDI.data[0] & 0xF0) == 0x90) {
+				group.noteOn(instance, event.MIDI.data[1], event.MIDI.data[2]);
+			} else if ((event.MIDI.data[0] & 0xF0) == 0x80) {
+				group.noteOff(instance);
+			}
+		} else {
+			AUAudioFrameCount const duration = event.head.eventType == AURenderEventParameterRamp ? event.parameter.rampDurationSampleFrames : 0;
+			group.startRamp(instance, event.parameter.parameterAddress, event.parameter.value, duration);
+		}
+	}
+
+	/*
+	 The group has its own envelopes and a PolyBLEP oscillator, and updates its filter every few frames,
+	 so its output can't match the kernel's sample for sample. What has to match is what it plays when:
+	 the RMS level of each window of the left channel, in dB, for the windows where the kernel is within
+	 groupLevelRangeDecibels of its loudest window. Quieter windows are release tails, where two exponential
+	 envelopes with slightly different shapes are many dB apart without anyone hearing a difference.
+	 */
+	static BasicSynth2LevelComparison compareLevels(BasicSynth2RenderedAudio const& kernel,
+												   BasicSynth2RenderedAudio const& group,
+												   BasicSynth2RegressionOptions const& options) {
+		BasicSynth2LevelComparison result;
+		size_t const window = std::max<size_t>(options.groupWindowFrames, 1);
+		size_t const windowCount = std::min(kernel.left.size(), group.left.size()) / window;
+
+		std::vector<double> kernelLevels(windowCount);
+		std::vector<double> groupLevels(windowCount);
+		double loudest = -std::numeric_limits<double>::infinity();
+		for (size_t w = 0; w < windowCount; ++w) {
+			kernelLevels[w] = levelDecibels(&kernel.left[w * window], window);
+			groupLevels[w] = levelDecibels(&group.left[w * window], window);
+			loudest = std::max(loudest, kernelLevels[w]);
+		}
+
+		for (size_t w = 0; w < windowCount; ++w) {
+			if (kernelLevels[w] < loudest - options.groupLevelRangeDecibels) {
+				continue;
+			}
+			++result.windows;
+			double const difference = std::fabs(groupLevels[w] - kernelLevels[w]);
+			if (difference > result.worstDifferenceDecibels || !std::isfinite(difference)) {
+				result.worstDifferenceDecibels = std::isfinite(difference) ? difference : std::numeric_limits<double>::infinity();
+				result.worstWindow = w;
+			}
+		}
+		result.passed = result.windows > 0 && result.worstDifferenceDecibels <= options.groupLevelToleranceDecibels;
+		return result;
+	}
+
+	static double levelDecibels(float const* samples, size_t count) {
+		double energy = 0;
+		for (size_t i = 0; i < count; ++i) {
+			energy += (double)samples[i] * (double)samples[i];
+		}
+		return energy > 0 ? 10.0 * std::log10(energy / count) : -std::numeric_limits<double>::infinity();
+	}
+
+	// Renders every scenario the group can play through the kernel and through the group, and compares levels.
+	static bool runGroupComparison(std::vector<BasicSynth2RegressionScenario> const& scenarios,
+								   BasicSynth2RegressionOptions const& options) {
+		bool allPassed = true;
+
+		for (auto const& scenario : scenarios) {
+			if (!groupCanRender(scenario)) {
+				std::cout << "[SKIP] " << scenario.name << " (group)" << std::endl;
+				continue;
+			}
+
+			BasicSynth2RenderedAudio const reference = render(scenario);
+			BasicSynth2RenderedAudio rendered;
+			bool const instancesMatch = renderGroup(scenario, options.groupInstances, rendered);
+			BasicSynth2LevelComparison result = compareLevels(reference, rendered, options);
+			result.instancesDiffer = !instancesMatch;
+			result.passed = result.passed && instancesMatch;
+
+			std::cout << (result.passed ? "[PASS] " : "[FAIL] ") << scenario.name << " (group)" << std::endl;
+			if (!result.passed) {
+				if (result.instancesDiffer) {
+					std::cout << "	instances playing the same events came out different" << std::endl;
+				}
+				std::cout << "	worst level difference: " << result.worstDifferenceDecibels << " dB in window "
+						  << result.worstWindow << " of " << result.windows << std::endl;
+			}
+			allPassed = allPassed && result.passed;
+		}
+
+		return allPassed;
+	}
+
+	// MARK: - Checks
+
+	// Checks of individual pieces that a reference can't pin down. Returns false if any failed.
+	static bool runChecks() {
+		bool allPassed = true;
+
+		// A snapshot published with an N-frame ramp must take N frames to land, however the host slices the render
+		// calls; the mailbox must hand over only the latest snapshot, once; and a bank must read back what was written.
+		AUAudioFrameCount const blockSizes[] = { 1, 64, 333, 4096 };
+		for (AUAudioFrameCount blockSize : blockSizes) {
+			allPassed = checkSnapshotRamp(1000, blockSize) && allPassed;
+		}
+		allPassed = checkSnapshotRamp(0, 64) && allPassed;
+		allPassed = checkMailbox() && allPassed;
+		allPassed = checkBankRoundTrip() && allPassed;
+
+		allPassed = checkExpressionSettles() && allPassed;
+		allPassed = checkNoteCache() && allPassed;
+		allPassed = checkEffectTail() && allPassed;
+		allPassed = checkDenormalScope() && allPassed;
+		return allPassed;
+	}
+
+	// MARK: Preset Snapshots
+
+	static bool checkSnapshotRamp(AUAudioFrameCount rampFrames, AUAudioFrameCount blockSize) {
+		BasicSynth2RegressionScenario scenario;
+		std::unique_ptr<BasicSynth2DSPKernel> kernel = makeKernel(scenario);
+		publishSnapshot(*kernel, BasicSynth2RegressionScenario::Snapshot { 0, { { FilterCutoffFrequencyAddress, 500.0f }, { PulseWidthAddress, 0.2f } }, rampFrames });
+
+		// Render until every parameter has reached the snapshot's value, a block at a time.
+		std::vector<float> left(blockSize), right(blockSize);
+		AUAudioFrameCount settledAt = 0;
+		for (AUAudioFrameCount rendered = 0; rendered <= rampFrames + blockSize; ) {
+			std::fill(left.begin(), left.end(), 0.0f);
+			std::fill(right.begin(), right.end(), 0.0f);
+			renderSegment(*kernel, nullptr, rendered, blockSize, left.data(), right.data());
+			rendered += blockSize;
+			if (kernel->parametersSettled()) {
+				settledAt = rendered;
+				break;
+			}
+		}
+
+		// The first block boundary at or after the end of the ramp.
+		AUAudioFrameCount const expected = (rampFrames + blockSize - 1) / blockSize * blockSize;
+		bool const passed = settledAt == std::max(expected, blockSize) && kernel->getParameter(FilterCutoffFrequencyAddress) == 500.0f;
+		std::string const name = "snapshot_ramp_" + std::to_string(rampFrames) + "_block_" + std::to_string(blockSize);
+		std::cout << (passed ? "[PASS] " : "[FAIL] ") << name << std::endl;
+		if (!passed) {
+			std::cout << "	settled after " << settledAt << " frames, expected " << std::max(expected, blockSize) << std::endl;
+		}
+		return passed;
+	}
+
+	static bool checkMailbox() {
+		BasicSynth2PresetMailbox mailbox;
+		bool passed = mailbox.consume() == nullptr;
+
+		BasicSynth2PresetSnapshot first, second;
+		first.parameterCount = second.parameterCount = 1;
+		first.values[0] = 1.0f;
+		second.values[0] = 2.0f;
+		mailbox.publish(first, 10);
+		mailbox.publish(second, 20);
+
+		BasicSynth2PresetMailbox::Pending const* pending = mailbox.consume();
+		passed = passed && pending != nullptr && pending->snapshot.values[0] == 2.0f && pending->rampFrames == 20;
+		passed = passed && mailbox.consume() == nullptr;
+
+		// Publishing while the reader holds a slot must not write into it.
+		mailbox.publish(first, 30);
+		passed = passed && pending->snapshot.values[0] == 2.0f;
+		pending = mailbox.consume();
+		passed = passed && pending != nullptr && pending->snapshot.values[0] == 1.0f && pending->rampFrames == 30;
+
+		std::cout << (passed ? "[PASS] " : "[FAIL] ") << "preset_mailbox" << std::endl;
+		return passed;
+	}
+
+	static bool checkBankRoundTrip() {
+		char path[] = "/tmp/BasicSynth2PresetBank.XXXXXX";
+		int const fd = mkstemp(path);
+		if (fd < 0) {
+			std::cout << "[FAIL] preset_bank: could not create a temporary file" << std::endl;
+			return false;
+		}
+		::close(fd);
+
+		BasicSynth2PresetSnapshot snapshots[3];
+		for (uint32_t i = 0; i < 3; ++i) {
+			snapshots[i].parameterCount = NumberOfFilterSynthEnumElements;
+			for (int address = 0; address < NumberOfFilterSynthEnumElements; ++address) {
+				snapshots[i].values[address] = (float)(i * 100 + address) * 0.25f;
+			}
+		}
+		// A corrupt entry is still counted but never handed out.
+		snapshots[2].magic = 0;
+
+		BasicSynth2PresetBank bank;
+		bool passed = BasicSynth2PresetBank::write(path, snapshots, 3) && bank.open(path) && bank.size() == 3;
+		for (uint32_t i = 0; passed && i < 2; ++i) {
+			BasicSynth2PresetSnapshot const* entry = bank.entry(i);
+			passed = entry != nullptr && memcmp(entry, &snapshots[i], sizeof(BasicSynth2PresetSnapshot)) == 0;
+		}
+		passed = passed && bank.entry(2) == nullptr && bank.entry(3) == nullptr;
+		bank.close();
+
+		// A file that isn't a bank, or is shorter than its header says, must not open.
+		FILE* file = fopen(path, "r+b");
+		if (file != nullptr) {
+			uint32_t const entryCount = 4;
+			fseek(file, offsetof(BasicSynth2PresetBank::FileHeader, entryCount), SEEK_SET);
+			fwrite(&entryCount, sizeof(entryCount), 1, file);
+			fclose(file);
+		}
+		passed = passed && file != nullptr && !bank.open(path);
+		unlink(path);
+
+		std::cout << (passed ? "[PASS] " : "[FAIL] ") << "preset_bank" << std::endl;
+		return passed;
+	}
+
+	// MARK: Expression
+
+	// Pressure and CC74 on the sounding channel, then back to rest: the lane must land exactly on neutral,
+	// or the kernel keeps taking its per-sample expression loop for the rest of the note.
+	// Steps the lanes the way run() does, a block of smooth() on the sounding lane and advance() for the rest.
+	static bool checkExpressionSettles() {
+		BasicSynth2ExpressionLanes lanes;
+		lanes.setSmoothingTime(0.005f, 44100.0f);
+		int const channel = BasicSynth2ExpressionLanes::kMasterChannel;
+		AUAudioFrameCount const blockSize = 512;
+
+		auto renderBlocks = [&](int blocks) {
+			for (int block = 0; block < blocks; ++block) {
+				bool const sounding = !lanes.isNeutral(channel);
+				if (sounding) {
+					float bend = lanes.pitchBend[channel];
+					float pressure = lanes.pressure[channel];
+					float timbre = lanes.timbre[channel];
+					for (AUAudioFrameCount frame = 0; frame < blockSize; ++frame) {
+						lanes.smooth(bend, pressure, timbre, channel);
+					}
+					lanes.pitchBend[channel] = bend;
+					lanes.pressure[channel] = pressure;
+					lanes.timbre[channel] = timbre;
+				}
+				lanes.advance(blockSize, sounding ? channel : -1);
+			}
+		};
+
+		lanes.setPressure(channel, 100);
+		lanes.setTimbre(channel, 20);
+		renderBlocks(20);
+		bool const moved = !lanes.isNeutral(channel);
+
+		lanes.setPressure(channel, 0);
+		lanes.setTimbre(channel, 64);
+		renderBlocks(20);
+		bool const passed = moved && lanes.isNeutral(channel);
+
+		std::cout << (passed ? "[PASS] " : "[FAIL] ") << "expression_settles" << std::endl;
+		if (!passed) {
+			std::cout << "	pressure " << lanes.pressure[channel] << ", timbre " << lanes.timbre[channel] << " after returning to rest" << std::endl;
+		}
+		return passed;
+	}
+
+	// MARK: Note Cache
+
+	// Two notes taking turns, each from silence: after the first of each, every note should come from the cache,
+	// and the bounce should match one rendered entirely live (a cache that keeps nothing) up to the tails the
+	// cache cuts off where the kernel turns the voice off. Then the cache must report its memory truthfully,
+	// and stay within a smaller capacity by evicting.
+	static bool checkNoteCache() {
+		BasicSynth2RegressionScenario scenario;
+		scenario.name = "note_cache";
+		scenario.frameCount = 16 * 12000;
+		// A short release, so the voice goes off well before the next note.
+		scenario.parameter(ReleaseDurationAddress, 0.01f)
+			.parameter(FilterReleaseDurationAddress, 0.01f);
+		for (int i = 0; i < 16; ++i) {
+			uint8_t const note = i % 2 == 0 ? 60 : 67;
+			scenario.noteOn(i * 12000 + 100, note, 100).noteOff(i * 12000 + 100 + 5000, note);
+		}
+
+		BasicSynth2NoteCache live(0);
+		BasicSynth2RenderedAudio const reference = renderCached(scenario, live);
+
+		BasicSynth2NoteCache cache;
+		BasicSynth2RenderedAudio const rendered = renderCached(scenario, cache);
+		BasicSynth2NoteCacheStatistics const stats = cache.statistics();
+
+		BasicSynth2RegressionOptions options;
+		options.mode = BasicSynth2RegressionOptions::Tolerance;
+		BasicSynth2ComparisonResult const result = compare(reference, rendered, options);
+		printResult("note_cache_matches_live", result);
+
+		bool const hitsPassed = stats.lookups == 16 && stats.hits == 14 && stats.insertions == 2 && live.statistics().hits == 0;
+		std::cout << (hitsPassed ? "[PASS] " : "[FAIL] ") << "note_cache_hit_rate" << std::endl;
+		if (!hitsPassed) {
+			std::cout << "	";
+			cache.printStatistics();
+		}
+
+		// Two notes held as stereo float audio, plus the entries' bookkeeping, and nothing for the cache that keeps nothing.
+		size_t const audioBytes = 2 * 2 * sizeof(float) * 5000;
+		bool memoryPassed = stats.entryCount == 2
+			&& stats.bytesUsed >= audioBytes
+			&& stats.bytesUsed <= cache.getCapacity()
+			&& live.statistics().bytesUsed == 0;
+
+		// Shrinking the cache below what it holds evicts the least recently used note.
+		cache.setCapacity(stats.bytesUsed - 1);
+		memoryPassed = memoryPassed
+			&& cache.statistics().entryCount == 1
+			&& cache.statistics().evictions == 1
+			&& cache.statistics().bytesUsed <= cache.getCapacity()
+			&& cache.statistics().bytesUsed > 0;
+		std::cout << (memoryPassed ? "[PASS] " : "[FAIL] ") << "note_cache_memory" << std::endl;
+
+		return result.passed && hitsPassed && memoryPassed;
+	}
+
+	// MARK: Send Effects
+
+	// The send bus must keep playing its tail after the send closes, and turn itself off once the tail has
+	// died away: no sooner than the longest delay after the send closed, and before the scenario ends.
+	// From then on the output is silence.
+	static bool checkEffectTail() {
+		bool allPassed = true;
+		for (uint32_t channelCount : { 2u, 1u }) {
+			BasicSynth2RegressionScenario const scenario = effectSendScenario(channelCount);
+			AUAudioFrameCount const sendClosed = 30000;
+			AUAudioFrameCount tailOff = 0;
+			bool tailAfterSendClosed = false;
+
+			BasicSynth2RenderedAudio const audio = render(scenario, [&](BasicSynth2DSPKernel const& kernel, AUAudioFrameCount blockEnd) {
+				if (kernel.hasEffectTail()) {
+					tailOff = 0;
+					tailAfterSendClosed = tailAfterSendClosed || blockEnd > sendClosed + 22050;
+				} else if (tailOff == 0) {
+					tailOff = blockEnd;
+				}
+			});
+
+			bool silentAfter = tailOff > 0;
+			for (AUAudioFrameCount i = tailOff; silentAfter && i < scenario.frameCount; ++i) {
+				silentAfter = audio.left[i] == 0.0f && audio.right[i] == 0.0f;
+			}
+
+			bool const passed = tailAfterSendClosed && tailOff > sendClosed && silentAfter;
+			std::cout << (passed ? "[PASS] " : "[FAIL] ") << scenario.name << "_tail_off" << std::endl;
+			if (!passed) {
+				std::cout << "	bus turned off at frame " << tailOff << (silentAfter ? "" : ", not silent after") << std::endl;
+			}
+			allPassed = allPassed && passed;
+		}
+		return allPassed;
+	}
+
+	// MARK: Denormals
+
+	// A render call must flush denormals to zero, then hand the host's render thread back its floating point
+	// state exactly as it was, whatever else the host had set in it: here, a non-default rounding mode.
+	static bool checkDenormalScope() {
+		int const callerRounding = fegetround();
+		uint64_t const callerState = BasicSynth2DenormalScope::read();
+		fesetround(FE_TOWARDZERO);
+		uint64_t const hostState = BasicSynth2DenormalScope::read();
+
+		bool flushedInside = false;
+		bool nestedRestored = false;
+		{
+			BasicSynth2DenormalScope scope;
+			// The product goes first: it raises status flags, which are sticky and live in the same register.
+			bool const flushed = BasicSynth2DenormalScope::kFlushBits == 0 || denormalProduct() == 0.0f;
+			uint64_t const inside = BasicSynth2DenormalScope::read();
+			flushedInside = flushed && (inside & BasicSynth2DenormalScope::kFlushBits) == BasicSynth2DenormalScope::kFlushBits;
+			{
+				BasicSynth2DenormalScope nested;
+			}
+			nestedRestored = BasicSynth2DenormalScope::read() == inside;
+		}
+		bool const restored = BasicSynth2DenormalScope::read() == hostState && fegetround() == FE_TOWARDZERO;
+
+		bool untouchedWhenDisabled = false;
+		{
+			BasicSynth2DenormalScope scope(false);
+			untouchedWhenDisabled = BasicSynth2DenormalScope::read() == hostState && denormalProduct() != 0.0f;
+		}
+
+		BasicSynth2DenormalScope::write(callerState);
+		fesetround(callerRounding);
+
+		bool const passed = flushedInside && nestedRestored && restored && untouchedWhenDisabled;
+		std::cout << (passed ? "[PASS] " : "[FAIL] ") << "denormal_scope_restores" << std::endl;
+		if (!passed) {
+			std::cout << "	flushed inside " << flushedInside << ", nested restored " << nestedRestored
+				<< ", restored " << restored << ", disabled untouched " << untouchedWhenDisabled << std::endl;
+		}
+		return passed;
+	}
+
+	// About 1e-40, a denormal, unless the floating point unit flushes it to zero.
+	static float denormalProduct() {
+		volatile float a = 1.0e-30f;
+		volatile float b = 1.0e-10f;
+		return a * b;
+	}
+
+	// MARK: - Canonical Scenarios
+
+	static BasicSynth2RegressionScenario effectSendScenario(uint32_t channelCount) {
+		BasicSynth2RegressionScenario scenario;
+		scenario.name = channelCount == 1 ? "effect_send_mono" : "effect_send";
+		scenario.channelCount = channelCount;
+		scenario.frameCount = 4 * 44100;
+		scenario.parameter(EffectSendAddress, 0.6f)
+			.parameter(DelayTimeAddress, 0.25f)
+			.parameter(DelayFeedbackAddress, 0.3f)
+			.parameter(ReverbSizeAddress, 0.2f)
+			.parameter(ReverbDampingAddress, 0.6f)
+			.parameter(ReleaseDurationAddress, 0.05f)
+			.noteOn(0, 60, 110)
+			.noteOff(8000, 60)
+			.noteOn(12000, 67, 90)
+			.noteOff(20000, 67)
+			.ramp(30000, EffectSendAddress, 0.0f, 0);
+		return scenario;
+	}
+
+	static std::vector<BasicSynth2RegressionScenario> defaultScenarios() {
+		std::vector<BasicSynth2RegressionScenario> scenarios;
+
+		{
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "single_note";
+			scenario.frameCount = 44100;
+			scenario.noteOn(0, 60, 100).noteOff(22050, 60);
+			scenarios.push_back(scenario);
+		}
+		{
+			// Notes landing mid-block, overlapping, and releasing into silence.
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "note_sequence";
+			scenario.frameCount = 88200;
+			uint8_t const notes[] = { 48, 55, 60, 64, 67, 72, 67, 64 };
+			for (int i = 0; i < 8; ++i) {
+				AUEventSampleTime const start = 1000 + i * 9000;
+				scenario.noteOn(start, notes[i], (uint8_t)(40 + i * 10)).noteOff(start + 6000, notes[i]);
+			}
+			scenarios.push_back(scenario);
+		}
+		{
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "parameter_ramps";
+			scenario.frameCount = 66150;
+			scenario.parameter(FilterCutoffFrequencyAddress, 200.0f)
+				.noteOn(0, 57, 110)
+				.ramp(512, FilterCutoffFrequencyAddress, 12000.0f, 20000)
+				.ramp(4410, PulseWidthAddress, 0.1f, 30000)
+				.ramp(30000, FilterEnvelopeStrengthAddress, 0.8f, 4096)
+				.noteOff(50000, 57);
+			scenarios.push_back(scenario);
+		}
+		{
+			// The filter envelope has to follow the gate while its strength is zero: a note released at
+			// zero strength must retrigger on the next note-on, and strength raised mid-note picks up
+			// the envelope where it is rather than starting an attack.
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "filter_envelope_gate";
+			scenario.frameCount = 88200;
+			scenario.parameter(FilterCutoffFrequencyAddress, 500.0f)
+				.parameter(FilterAttackDurationAddress, 0.05f)
+				.parameter(FilterDecayDurationAddress, 0.2f)
+				.parameter(FilterSustainLevelAddress, 0.3f)
+				.noteOn(0, 52, 100)
+				.noteOff(8000, 52)
+				.noteOn(30000, 59, 100)
+				.ramp(40000, FilterEnvelopeStrengthAddress, 0.9f, 0)
+				.noteOff(60000, 59)
+				.ramp(61000, FilterEnvelopeStrengthAddress, 0.0f, 0)
+				.noteOn(75000, 47, 100)
+				.ramp(75600, FilterEnvelopeStrengthAddress, 0.9f, 0);
+			scenarios.push_back(scenario);
+		}
+		{
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "pitch_bend";
+			scenario.frameCount = 44100;
+			scenario.noteOn(0, 64, 90)
+				.ramp(100, PitchBendAddress, 2.0f, 11025)
+				.ramp(22050, PitchBendAddress, -12.0f, 0)
+				.ramp(33075, PitchBendAddress, 0.0f, 5000)
+				.noteOff(40000, 64);
+			scenarios.push_back(scenario);
+		}
+		{
+			// The pitch wheel on channel 1 bends +/- 2 semitones like any keyboard's; an MPE member channel +/- 48.
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "pitch_wheel";
+			scenario.frameCount = 44100;
+			scenario.noteOn(0, 60, 100)
+				.midi(4000, 0xE0, 0x7F, 0x7F)
+				.midi(11025, 0xE0, 0x00, 0x40)
+				.noteOff(14000, 60)
+				.midi(16000, 0xE1, 0x00, 0x50)
+				.midi(22050, 0x91, 60, 100)
+				.midi(38000, 0x81, 60, 0);
+			scenarios.push_back(scenario);
+		}
+		{
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "unison_wavetable";
+			scenario.frameCount = 44100;
+			scenario.parameter(UnisonVoicesAddress, 7.0f)
+				.parameter(UnisonDetuneAddress, 25.0f)
+				.parameter(WavetableMixAddress, 0.5f)
+				.noteOn(0, 45, 120)
+				.ramp(0, WavetablePositionAddress, 1.0f, 30000)
+				.noteOff(33000, 45);
+			scenarios.push_back(scenario);
+		}
+
+		{
+			// The host changing the sample rate while a note is sounding, then again back down.
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "sample_rate_change";
+			scenario.frameCount = 96000;
+			scenario.blockSize = 256;
+			scenario.parameter(FilterEnvelopeStrengthAddress, 0.5f)
+				.noteOn(0, 60, 100)
+				.ramp(0, FilterCutoffFrequencyAddress, 4000.0f, 20000)
+				.sampleRateChange(20000, 96000.0)
+				.noteOn(24000, 67, 100)
+				.noteOff(40000, 67)
+				.sampleRateChange(60100, 48000.0)
+				.noteOn(62000, 64, 90)
+				.noteOff(80000, 64);
+			scenarios.push_back(scenario);
+		}
+
+		{
+			// Presets picked while a note is sounding: a slow crossfade over many render calls, then a jump.
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "preset_snapshot";
+			scenario.frameCount = 66150;
+			scenario.blockSize = 256;
+			scenario.parameter(FilterCutoffFrequencyAddress, 6000.0f)
+				.noteOn(0, 55, 100)
+				.snapshot(4410, { { FilterCutoffFrequencyAddress, 600.0f }, { PulseWidthAddress, 0.15f }, { SustainLevelAddress, 0.6f } }, 13230)
+				.snapshot(33075, { { FilterCutoffFrequencyAddress, 3000.0f }, { PulseWidthAddress, 0.4f } }, 0)
+				.noteOff(55000, 55);
+			scenarios.push_back(scenario);
+		}
+
+		{
+			// Channel pressure and CC74 sweeping under a held note, then coming back to rest.
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "pressure_timbre";
+			scenario.frameCount = 66150;
+			scenario.blockSize = 256;
+			scenario.parameter(FilterCutoffFrequencyAddress, 2000.0f)
+				.noteOn(0, 50, 100);
+			for (int step = 0; step < 32; ++step) {
+				AUEventSampleTime const time = 2000 + step * 600;
+				uint8_t const rising = (uint8_t)(step * 4);
+				scenario.midi(time, 0xD0, rising, 0)
+					.midi(time + 300, 0xB0, 74, (uint8_t)(127 - rising));
+			}
+			scenario.midi(24000, 0xD0, 0, 0)
+				.midi(24000, 0xB0, 74, 64)
+				.noteOff(50000, 50);
+			scenarios.push_back(scenario);
+		}
+
+		// A note through the delay and the reverb, then the send closed so the tail plays out and the bus turns
+		// itself off, in stereo and into a single mono buffer (where both returns land on the one channel).
+		for (uint32_t channelCount : { 2u, 1u }) {
+			scenarios.push_back(effectSendScenario(channelCount));
+		}
+
+		// The same short phrase at other sample rates and an odd block size.
+		double const sampleRates[] = { 48000.0, 96000.0 };
+		for (double sampleRate : sampleRates) {
+			BasicSynth2RegressionScenario scenario;
+			scenario.name = "sample_rate_" + std::to_string((int)sampleRate);
+			scenario.sampleRate = sampleRate;
+			scenario.blockSize = 333;
+			scenario.frameCount = (AUAudioFrameCount)sampleRate;
+			scenario.noteOn(0, 69, 100)
+				.ramp(0, FilterCutoffFrequencyAddress, 3000.0f, (AUAudioFrameCount)(sampleRate / 4))
+				.noteOff((AUEventSampleTime)(sampleRate / 2), 69);
+			scenarios.push_back(scenario);
+		}
+
+		return scenarios;
+	}
+};
+
+#endif /* BasicSynth2RegressionHarness_hpp */
@@ -0,0 +1,674 @@
+//
+//  BasicSynth2RenderServer.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2RenderServer_hpp
+#define BasicSynth2RenderServer_hpp
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+#include "BasicSynth2DSPKernel.hpp"
+#include "BasicSynth2RegressionHarness.hpp"
+
+// MARK: - BasicSynth2RenderRing
+/*
+ BasicSynth2RenderRing
+
+ The shared memory a host and an out-of-process render server talk through. It is a single producer,
+ single consumer ring of slots; each slot holds one render call: the event list going to the server
+ and the audio coming back.
+
+	Header | slot 0 | slot 1 | ... | slot slotCount - 1
+	slot:  Block | AURenderEvent[maxEvents] | channel 0 [maxFrames] | channel 1 [maxFrames]
+
+ The server renders straight into the slot's channel buffers and the host reads them in place,
+ so no sample data is ever copied on the way through.
+
+ Two counters drive the ring: the host bumps submitted after filling a slot and the server bumps
+ completed after rendering one. Each side spins briefly on the other's counter and then sleeps on it.
+ On Linux the sleep is a futex on the counter itself, so there are no extra file descriptors to hand
+ between the processes, and a wake is only issued when the other side is actually asleep.
+ Darwin has no public futex, so there the sleep falls back to short naps.
+ */
+class BasicSynth2RenderRing {
+public:
+	struct Counter {
+		std::atomic<uint32_t> value { 0 };
+		std::atomic<uint32_t> sleepers { 0 };
+	};
+
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t slotCount;
+		uint32_t maxFrames;
+		uint32_t maxEvents;
+		uint32_t channelCount;
+		double sampleRate;
+		uint64_t slotSize;
+		std::atomic<uint32_t> shutdown;
+
+		alignas(64) Counter submitted;	// written by the host
+		alignas(64) Counter completed;	// written by the server
+	};
+
+	struct Block {
+		AUEventSampleTime sampleTime;
+		AUAudioFrameCount frameCount;
+		uint32_t eventCount;
+	};
+
+	enum {
+		kMagic = 0x53325342, // 'BS2S'
+		kVersion = 1,
+		kAlignment = 64,
+		kChannelCount = 2
+	};
+
+	BasicSynth2RenderRing() = default;
+	BasicSynth2RenderRing(BasicSynth2RenderRing const&) = delete;
+	BasicSynth2RenderRing& operator=(BasicSynth2RenderRing const&) = delete;
+
+	~BasicSynth2RenderRing() {
+		close();
+	}
+
+	// Host side. Creates the shared memory object called name, which must start with a slash. Fails if
+	// it already exists: it may belong to another live instance, so it is never unlinked from here.
+	bool create(char const* name, double sampleRate, uint32_t maxFrames, uint32_t slotCount, uint32_t maxEvents) {
+		close();
+		if (maxFrames == 0 || slotCount == 0) {
+			return false;
+		}
+
+		uint64_t const slotSize = alignUp(sizeof(Block) + (size_t)maxEvents * sizeof(AURenderEvent))
+								+ alignUp((size_t)maxFrames * sizeof(float)) * kChannelCount;
+		size_t const length = alignUp(sizeof(Header)) + (size_t)slotSize * slotCount;
+
+		int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0) {
+			if (errno == EEXIST) {
+				std::cout << "BasicSynth2RenderRing: " << name << " is already in use" << std::endl;
+			}
+			return false;
+		}
+		if (ftruncate(fd, (off_t)length) != 0 || !map(fd, length)) {
+			::close(fd);
+			shm_unlink(name);
+			return false;
+		}
+		::close(fd);
+
+		header = new (mappedBytes) Header();
+		header->magic = kMagic;
+		header->version = kVersion;
+		header->slotCount = slotCount;
+		header->maxFrames = maxFrames;
+		header->maxEvents = maxEvents;
+		header->channelCount = kChannelCount;
+		header->sampleRate = sampleRate;
+		header->slotSize = slotSize;
+		header->shutdown.store(0, std::memory_order_relaxed);
+
+		ownedName = name;
+		return true;
+	}
+
+	// Server side.
+	bool attach(char const* name) {
+		close();
+
+		int fd = shm_open(name, O_RDWR, 0);
+		if (fd < 0) {
+			return false;
+		}
+
+		struct stat info;
+		bool ok = fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(Header) && map(fd, (size_t)info.st_size);
+		::close(fd);
+		if (!ok) {
+			return false;
+		}
+
+		header = (Header*)mappedBytes;
+		if (header->magic != kMagic
+			|| header->version != kVersion
+			|| header->channelCount != kChannelCount
+			|| mappedLength < alignUp(sizeof(Header)) + (size_t)header->slotSize * header->slotCount) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+		if (mappedBytes != nullptr) {
+			munmap(mappedBytes, mappedLength);
+		}
+		if (!ownedName.empty()) {
+			shm_unlink(ownedName.c_str());
+		}
+		mappedBytes = nullptr;
+		mappedLength = 0;
+		header = nullptr;
+		ownedName.clear();
+	}
+
+	bool isOpen() const { return header != nullptr; }
+
+	Header& getHeader() const { return *header; }
+
+	// The slot a sequence number lands in.
+	Block* block(uint32_t sequence) const {
+		return (Block*)((uint8_t*)mappedBytes + alignUp(sizeof(Header)) + (size_t)header->slotSize * (sequence % header->slotCount));
+	}
+
+	AURenderEvent* events(Block* slot) const {
+		return (AURenderEvent*)(slot + 1);
+	}
+
+	float* channel(Block* slot, uint32_t index) const {
+		size_t const audioOffset = alignUp(sizeof(Block) + (size_t)header->maxEvents * sizeof(AURenderEvent));
+		return (float*)((uint8_t*)slot + audioOffset + alignUp((size_t)header->maxFrames * sizeof(float)) * index);
+	}
+
+	// MARK: Signalling
+
+	static void publish(Counter& counter, uint32_t value) {
+		counter.value.store(value, std::memory_order_seq_cst);
+		if (counter.sleepers.load(std::memory_order_seq_cst) != 0) {
+#if defined(__linux__)
+			syscall(SYS_futex, (uint32_t*)&counter.value, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+#endif
+		}
+	}
+
+	// Returns the counter's value once it differs from current, or current if timeoutMilliseconds passed
+	// or stop became non-zero. Whoever sets stop publishes the counter's unchanged value to wake the waiter.
+	static uint32_t waitForChange(Counter& counter, uint32_t current, uint32_t timeoutMilliseconds,
+								  std::atomic<uint32_t> const* stop = nullptr) {
+		for (int spin = 0; spin < 4096; ++spin) {
+			uint32_t const value = counter.value.load(std::memory_order_acquire);
+			if (value != current || isStopped(stop)) {
+				return value;
+			}
+		}
+
+		auto const deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMilliseconds);
+		while (true) {
+			counter.sleepers.fetch_add(1, std::memory_order_seq_cst);
+			uint32_t value = counter.value.load(std::memory_order_seq_cst);
+			if (value == current) {
+#if defined(__linux__)
+				// Sleeps only if the counter still holds current, so a publish in between can't be missed.
+				struct timespec const timeout = { 0, 10 * 1000 * 1000 };
+				syscall(SYS_futex, (uint32_t*)&counter.value, FUTEX_WAIT, current, &timeout, nullptr, 0);
+#else
+				struct timespec const nap = { 0, 50 * 1000 };
+				nanosleep(&nap, nullptr);
+#endif
+				value = counter.value.load(std::memory_order_acquire);
+			}
+			counter.sleepers.fetch_sub(1, std::memory_order_seq_cst);
+
+			if (value != current || isStopped(stop) || std::chrono::steady_clock::now() >= deadline) {
+				return value;
+			}
+		}
+	}
+
+	static bool isStopped(std::atomic<uint32_t> const* stop) {
+		return stop != nullptr && stop->load(std::memory_order_acquire) != 0;
+	}
+
+private:
+	void* mappedBytes = nullptr;
+	size_t mappedLength = 0;
+	Header* header = nullptr;
+	std::string ownedName;
+
+	static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "Counters are shared between processes and waited on as plain 32 bit words");
+#if __cplusplus >= 201703L
+	static_assert(std::atomic<uint32_t>::is_always_lock_free, "Counters are shared between processes, so they can't hide behind a lock");
+#else
+	static_assert(ATOMIC_INT_LOCK_FREE == 2, "Counters are shared between processes, so they can't hide behind a lock");
+#endif
+
+	static size_t alignUp(size_t size) {
+		return (size + kAlignment - 1) / kAlignment * kAlignment;
+	}
+
+	bool map(int fd, size_t length) {
+		void* mapped = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (mapped == MAP_FAILED) {
+			return false;
+		}
+		mappedBytes = mapped;
+		mappedLength = length;
+		return true;
+	}
+};
+
+
+// MARK: - BasicSynth2RenderServer
+/*
+ BasicSynth2RenderServer
+
+ Runs a BasicSynth2DSPKernel in its own process on behalf of a host. serve() attaches to the ring,
+ renders each submitted slot in order with processWithEvents(), and returns once the host asks it to stop
+ (or the host has been silent for idleTimeoutMilliseconds, in case it went away without saying so).
+ */
+class BasicSynth2RenderServer {
+public:
+	static bool serve(char const* name, uint32_t idleTimeoutMilliseconds = 5000) {
+		BasicSynth2RenderRing ring;
+		if (!ring.attach(name)) {
+			std::cout << "BasicSynth2RenderServer: could not attach to " << name << std::endl;
+			return false;
+		}
+
+		BasicSynth2RenderRing::Header& header = ring.getHeader();
+		std::unique_ptr<BasicSynth2DSPKernel> kernel(new BasicSynth2DSPKernel());
+		kernel->init((int)header.channelCount, header.sampleRate);
+		kernel->reset();
+		kernel->setMaximumFramesToRender(header.maxFrames);
+
+		uint8_t bufferListStorage[offsetof(AudioBufferList, mBuffers) + BasicSynth2RenderRing::kChannelCount * sizeof(AudioBuffer)];
+		AudioBufferList* bufferList = (AudioBufferList*)bufferListStorage;
+		bufferList->mNumberBuffers = header.channelCount;
+
+		uint32_t rendered = header.completed.value.load(std::memory_order_relaxed);
+		uint32_t submitted = header.submitted.value.load(std::memory_order_acquire);
+
+		while (true) {
+			if (submitted == rendered) {
+				if (header.shutdown.load(std::memory_order_acquire) != 0) {
+					break;
+				}
+				uint32_t const latest = BasicSynth2RenderRing::waitForChange(header.submitted, submitted, idleTimeoutMilliseconds, &header.shutdown);
+				if (latest == submitted && header.shutdown.load(std::memory_order_acquire) == 0) {
+					std::cout << "BasicSynth2RenderServer: host went quiet, stopping" << std::endl;
+					break;
+				}
+				submitted = latest;
+				continue;
+			}
+
+			BasicSynth2RenderRing::Block* block = ring.block(rendered);
+			AUAudioFrameCount const frames = std::min<AUAudioFrameCount>(block->frameCount, header.maxFrames);
+			uint32_t const eventCount = frames > 0 ? std::min(block->eventCount, header.maxEvents) : 0;
+
+			// The events live in shared memory; link them up with this process's addresses. The host is another
+			// process and can't be trusted to have kept them inside the block and in order, and processWithEvents()
+			// would render out of bounds if they weren't, so they are clamped into place here.
+			AURenderEvent* events = ring.events(block);
+			AUEventSampleTime earliest = block->sampleTime;
+			AUEventSampleTime const latest = block->sampleTime + (AUEventSampleTime)frames - 1;
+			for (uint32_t i = 0; i < eventCount; ++i) {
+				earliest = std::min(std::max(events[i].head.eventSampleTime, earliest), latest);
+				events[i].head.eventSampleTime = earliest;
+				events[i].head.next = (i + 1 < eventCount) ? &events[i + 1] : nullptr;
+			}
+
+			for (UInt32 channel = 0; channel < header.channelCount; ++channel) {
+				float* samples = ring.channel(block, channel);
+				memset(samples, 0, frames * sizeof(float));
+				bufferList->mBuffers[channel].mNumberChannels = 1;
+				bufferList->mBuffers[channel].mDataByteSize = UInt32(frames * sizeof(float));
+				bufferList->mBuffers[channel].mData = samples;
+			}
+
+			AudioTimeStamp timestamp;
+			memset(&timestamp, 0, sizeof(timestamp));
+			timestamp.mSampleTime = block->sampleTime;
+			timestamp.mFlags = kAudioTimeStampSampleTimeValid;
+
+			kernel->setOutputBuffer(bufferList);
+			kernel->processWithEvents(&timestamp, frames, eventCount > 0 ? events : nullptr);
+
+			BasicSynth2RenderRing::publish(header.completed, ++rendered);
+		}
+
+		return true;
+	}
+};
+
+
+// MARK: - BasicSynth2RenderClient
+/*
+ BasicSynth2RenderClient
+
+ The host's end of the ring. Up to slotCount blocks can be in flight:
+
+	Block* block = client.beginBlock(sampleTime, frames);	// nullptr while the ring is full
+	client.addEvent(block, event);
+	client.submit();
+	Block* done = client.waitForBlock(timeout);		// oldest block in flight, rendered
+	... read client.channel(done, 0 / 1) in place ...
+	client.releaseBlock();
+ */
+class BasicSynth2RenderClient {
+public:
+	bool create(char const* name, double sampleRate, uint32_t maxFrames, uint32_t slotCount = 4, uint32_t maxEvents = 64) {
+		submitted = 0;
+		released = 0;
+		return ring.create(name, sampleRate, maxFrames, slotCount, maxEvents);
+	}
+
+	BasicSynth2RenderRing::Block* beginBlock(AUEventSampleTime sampleTime, AUAudioFrameCount frames) {
+		BasicSynth2RenderRing::Header& header = ring.getHeader();
+		if (submitted - released >= header.slotCount || frames > header.maxFrames) {
+			return nullptr;
+		}
+		BasicSynth2RenderRing::Block* block = ring.block(submitted);
+		block->sampleTime = sampleTime;
+		block->frameCount = frames;
+		block->eventCount = 0;
+		return block;
+	}
+
+	// Returns false if the block is full, or the event is outside the block or earlier than the last one added.
+	bool addEvent(BasicSynth2RenderRing::Block* block, AURenderEvent const& event) {
+		AUEventSampleTime const time = event.head.eventSampleTime;
+		if (block->eventCount >= ring.getHeader().maxEvents
+			|| time < block->sampleTime
+			|| time >= block->sampleTime + (AUEventSampleTime)block->frameCount
+			|| (block->eventCount > 0 && time < ring.events(block)[block->eventCount - 1].head.eventSampleTime)) {
+			return false;
+		}
+		AURenderEvent* slot = ring.events(block) + block->eventCount++;
+		*slot = event;
+		slot->head.next = nullptr;
+		return true;
+	}
+
+	void submit() {
+		BasicSynth2RenderRing::publish(ring.getHeader().submitted, ++submitted);
+	}
+
+	// The oldest block in flight once the server has rendered it, or nullptr on timeout.
+	BasicSynth2RenderRing::Block* waitForBlock(uint32_t timeoutMilliseconds) {
+		if (released == submitted) {
+			return nullptr;
+		}
+		BasicSynth2RenderRing::Counter& completed = ring.getHeader().completed;
+		uint32_t value = completed.value.load(std::memory_order_acquire);
+		while ((int32_t)(value - released) <= 0) {
+			uint32_t const latest = BasicSynth2RenderRing::waitForChange(completed, value, timeoutMilliseconds);
+			if (latest == value) {
+				return nullptr;
+			}
+			value = latest;
+		}
+		return ring.block(released);
+	}
+
+	float const* channel(BasicSynth2RenderRing::Block* block, uint32_t index) const {
+		return ring.channel(block, index);
+	}
+
+	// Hands the oldest block's slot back for reuse.
+	void releaseBlock() {
+		if (released != submitted) {
+			++released;
+		}
+	}
+
+	// Stops the server. Publishing the unchanged count wakes it if it is asleep; it sees the flag and returns.
+	void shutdown() {
+		if (!ring.isOpen()) {
+			return;
+		}
+		BasicSynth2RenderRing::Header& header = ring.getHeader();
+		header.shutdown.store(1, std::memory_order_release);
+		BasicSynth2RenderRing::publish(header.submitted, submitted);
+	}
+
+	void close() {
+		ring.close();
+	}
+
+private:
+	BasicSynth2RenderRing ring;
+	uint32_t submitted = 0;
+	uint32_t released = 0;
+};
+
+
+// MARK: - BasicSynth2RenderServerBenchmark
+/*
+ BasicSynth2RenderServerBenchmark
+
+ A small local test host: forks a render server, plays a short note pattern through it one block at a
+ time, and reports the round trip (submit to rendered block in hand) per block: mean, percentiles and
+ jitter (standard deviation). The figures are only meaningful on a quiet machine, and include
+ the kernel's own render time.
+ */
+struct BasicSynth2RoundTripStatistics {
+	uint32_t blocks = 0;
+	uint32_t timeouts = 0;
+	double meanMicroseconds = 0;
+	double minimumMicroseconds = 0;
+	double medianMicroseconds = 0;
+	double p99Microseconds = 0;
+	double maximumMicroseconds = 0;
+	double jitterMicroseconds = 0;
+	float peak = 0;
+};
+
+class BasicSynth2RenderServerBenchmark {
+public:
+	static BasicSynth2RoundTripStatistics run(uint32_t blockCount = 2000, AUAudioFrameCount frames = 128, double sampleRate = 44100.0) {
+		BasicSynth2RoundTripStatistics statistics;
+		std::string const name = "/bs2-render-" + std::to_string((long)getpid());
+
+		BasicSynth2RenderClient client;
+		if (!client.create(name.c_str(), sampleRate, frames)) {
+			std::cout << "BasicSynth2RenderServerBenchmark: could not create " << name << std::endl;
+			return statistics;
+		}
+
+		pid_t const server = fork();
+		if (server < 0) {
+			client.close();
+			return statistics;
+		}
+		if (server == 0) {
+			_exit(BasicSynth2RenderServer::serve(name.c_str()) ? 0 : 1);
+		}
+
+		// Same starting point as BasicSynth2DSPKernelAdapter, sent the way a host would, then a note every
+		// half second, held for a quarter.
+		AUAudioFrameCount const totalFrames = blockCount * frames;
+		uint32_t const noteLength = (uint32_t)(sampleRate / 4);
+		BasicSynth2RegressionScenario pattern;
+		pattern.ramp(0, FilterCutoffFrequencyAddress, 11025.0f, 0)
+			   .ramp(0, PulseWidthAddress, 0.5f, 0);
+		for (AUEventSampleTime time = 0; time < (AUEventSampleTime)totalFrames; time += 2 * noteLength) {
+			pattern.noteOn(time, 60, 100).noteOff(time + noteLength, 60);
+		}
+		std::vector<AURenderEvent> const events = BasicSynth2RegressionHarness::sortedEvents(pattern);
+		size_t nextEvent = 0;
+
+		std::vector<double> roundTrips;
+		roundTrips.reserve(blockCount);
+
+		for (uint32_t index = 0; index < blockCount; ++index) {
+			AUEventSampleTime const start = (AUEventSampleTime)index * frames;
+			BasicSynth2RenderRing::Block* block = client.beginBlock(start, frames);
+			while (nextEvent < events.size() && events[nextEvent].head.eventSampleTime < start + frames) {
+				client.addEvent(block, events[nextEvent++]);
+			}
+
+			auto const sent = std::chrono::steady_clock::now();
+			client.submit();
+			BasicSynth2RenderRing::Block* done = client.waitForBlock(1000);
+			auto const received = std::chrono::steady_clock::now();
+
+			if (done == nullptr) {
+				++statistics.timeouts;
+				break;
+			}
+			for (uint32_t channel = 0; channel < BasicSynth2RenderRing::kChannelCount; ++channel) {
+				float const* samples = client.channel(done, channel);
+				for (AUAudioFrameCount i = 0; i < frames; ++i) {
+					statistics.peak = std::max(statistics.peak, fabsf(samples[i]));
+				}
+			}
+			client.releaseBlock();
+			roundTrips.push_back(std::chrono::duration<double, std::micro>(received - sent).count());
+		}
+
+		client.shutdown();
+		int status = 0;
+		if (statistics.timeouts > 0) {
+			kill(server, SIGTERM);
+		}
+		waitpid(server, &status, 0);
+		client.close();
+
+		summarize(roundTrips, statistics);
+		return statistics;
+	}
+
+	// Checks against a forked server: addEvent() turns away events outside the block or out of order, the server
+	// survives a block whose events were written past addEvent() the way a misbehaving host could, and a server
+	// that has gone to sleep waiting for work stops promptly on shutdown() rather than at its idle timeout.
+	static bool runChecks(AUAudioFrameCount frames = 128, double sampleRate = 44100.0) {
+		std::string const name = "/bs2-check-" + std::to_string((long)getpid());
+
+		BasicSynth2RenderClient client;
+		if (!client.create(name.c_str(), sampleRate, frames)) {
+			std::cout << "[FAIL] render_server: could not create " << name << std::endl;
+			return false;
+		}
+
+		pid_t const server = fork();
+		if (server < 0) {
+			client.close();
+			std::cout << "[FAIL] render_server: could not fork" << std::endl;
+			return false;
+		}
+		if (server == 0) {
+			_exit(BasicSynth2RenderServer::serve(name.c_str()) ? 0 : 1);
+		}
+
+		BasicSynth2RegressionScenario events;
+		events.noteOn(-1, 60, 100)
+			.noteOn((AUEventSampleTime)frames, 60, 100)
+			.noteOn(64, 60, 100)
+			.noteOn(10, 60, 100)
+			.noteOff(64, 60);
+
+		BasicSynth2RenderRing::Block* block = client.beginBlock(0, frames);
+		bool const rejected = !client.addEvent(block, events.events[0])
+			&& !client.addEvent(block, events.events[1])
+			&& client.addEvent(block, events.events[2])
+			&& !client.addEvent(block, events.events[3])
+			&& client.addEvent(block, events.events[4])
+			&& block->eventCount == 2;
+		std::cout << (rejected ? "[PASS] " : "[FAIL] ") << "render_server_add_event" << std::endl;
+
+		// Straight into the slot, the way the layout puts them: before the block, after it, and going backwards.
+		AURenderEvent* slot = (AURenderEvent*)(block + 1);
+		AUEventSampleTime const times[] = { -100000, (AUEventSampleTime)1 << 40, 5, 0 };
+		block->eventCount = 4;
+		for (uint32_t i = 0; i < 4; ++i) {
+			slot[i] = events.events[2];
+			slot[i].head.eventSampleTime = times[i];
+		}
+		client.submit();
+
+		BasicSynth2RenderRing::Block* done = client.waitForBlock(1000);
+		bool survived = done != nullptr;
+		for (uint32_t channel = 0; survived && channel < BasicSynth2RenderRing::kChannelCount; ++channel) {
+			float const* samples = client.channel(done, channel);
+			for (AUAudioFrameCount i = 0; i < frames; ++i) {
+				survived = survived && std::isfinite(samples[i]);
+			}
+		}
+		client.releaseBlock();
+		std::cout << (survived ? "[PASS] " : "[FAIL] ") << "render_server_clamps_events" << std::endl;
+
+		// Long enough for the server to stop spinning and sleep on the counter.
+		struct timespec const pause = { 0, 100 * 1000 * 1000 };
+		nanosleep(&pause, nullptr);
+
+		auto const asked = std::chrono::steady_clock::now();
+		client.shutdown();
+		int status = 0;
+		waitpid(server, &status, 0);
+		double const milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - asked).count();
+		client.close();
+
+		bool const stopped = survived && WIFEXITED(status) && WEXITSTATUS(status) == 0 && milliseconds < 500.0;
+		std::cout << (stopped ? "[PASS] " : "[FAIL] ") << "render_server_shutdown (" << milliseconds << " ms)" << std::endl;
+
+		return rejected && survived && stopped;
+	}
+
+	static void print(BasicSynth2RoundTripStatistics const& statistics) {
+		std::cout << "Render server round trip over " << statistics.blocks << " blocks"
+				  << (statistics.timeouts > 0 ? " (timed out)" : "") << std::endl;
+		std::cout << "	mean " << statistics.meanMicroseconds << " us, jitter " << statistics.jitterMicroseconds << " us" << std::endl;
+		std::cout << "	min " << statistics.minimumMicroseconds << " / median " << statistics.medianMicroseconds
+				  << " / p99 " << statistics.p99Microseconds << " / max " << statistics.maximumMicroseconds << " us" << std::endl;
+		std::cout << "	output peak " << statistics.peak << std::endl;
+	}
+
+private:
+	static void summarize(std::vector<double> roundTrips, BasicSynth2RoundTripStatistics& statistics) {
+		statistics.blocks = (uint32_t)roundTrips.size();
+		if (roundTrips.empty()) {
+			return;
+		}
+
+		double sum = 0;
+		for (double value : roundTrips) {
+			sum += value;
+		}
+		double const mean = sum / roundTrips.size();
+		double variance = 0;
+		for (double value : roundTrips) {
+			variance += (value - mean) * (value - mean);
+		}
+
+		std::sort(roundTrips.begin(), roundTrips.end());
+		statistics.meanMicroseconds = mean;
+		statistics.jitterMicroseconds = std::sqrt(variance / roundTrips.size());
+		statistics.minimumMicroseconds = roundTrips.front();
+		statistics.medianMicroseconds = roundTrips[roundTrips.size() / 2];
+		statistics.p99Microseconds = roundTrips[std::min(roundTrips.size() - 1, roundTrips.size() * 99 / 100)];
+		statistics.maximumMicroseconds = roundTrips.back();
+	}
+};
+
+#endif /* BasicSynth2RenderServer_hpp */
@@ -0,0 +1,140 @@
+//
+//  BasicSynth2TailBenchmark.hpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#ifndef BasicSynth2TailBenchmark_hpp
+#define BasicSynth2TailBenchmark_hpp
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "BasicSynth2DSPKernel.hpp"
+#include "BasicSynth2RegressionHarness.hpp"
+
+// MARK: - BasicSynth2TailBenchmark
+/*
+ BasicSynth2TailBenchmark
+
+ Render cost per block across the life of a note: while it's held, during its release, while its
+ envelope and filter state decay towards the denormal range, and once that state has got there.
+
+ The kernel normally turns a voice off long before then, so the benchmark renders with
+ turnOffFinishedVoices off and a short release. The envelopes are one-pole decays, which without
+ flush-to-zero come to rest on the smallest denormals instead of reaching zero, so the last phase
+ measures the denormal slow path for as long as the note would otherwise have stayed silent.
+ Run it with flushDenormals on and off to see what the flush-to-zero scope is saving.
+
+ A single run is at the mercy of whatever else the machine is doing, so compare medianOfRuns() figures.
+ The regression runner prints them with --tail-benchmark.
+ */
+
+struct BasicSynth2TailProfile {
+	// Median nanoseconds per block.
+	double sustain = 0;
+	double release = 0;
+	double decay = 0;
+	double denormal = 0;
+};
+
+class BasicSynth2TailBenchmark {
+public:
+	static BasicSynth2TailProfile run(bool flushDenormals, AUAudioFrameCount blockSize = 256, double sampleRate = 44100.0, int repeats = 4) {
+		// A full scale exponential decay is below the smallest normal float (about e^-87) after 87 time
+		// constants, so by 100 the envelope and filter state have settled on denormals (or zero).
+		float const releaseTime = 0.02f;
+		AUAudioFrameCount const noteOff = (AUAudioFrameCount)sampleRate;
+		AUAudioFrameCount const releaseEnd = noteOff + (AUAudioFrameCount)(10 * releaseTime * sampleRate);
+		AUAudioFrameCount const decayEnd = noteOff + (AUAudioFrameCount)(100 * releaseTime * sampleRate);
+
+		BasicSynth2RegressionScenario scenario;
+		scenario.sampleRate = sampleRate;
+		scenario.blockSize = blockSize;
+		scenario.frameCount = decayEnd + (AUAudioFrameCount)(2 * sampleRate);
+		scenario.parameter(ReleaseDurationAddress, releaseTime)
+			.parameter(FilterReleaseDurationAddress, releaseTime)
+			.parameter(FilterEnvelopeStrengthAddress, 0.5f)
+			.parameter(FilterCutoffFrequencyAddress, 2000.0f)
+			.noteOn(0, 48, 110)
+			.noteOff(noteOff, 48);
+
+		std::vector<double> phases[4];
+		std::vector<float> left(blockSize);
+		std::vector<float> right(blockSize);
+
+		for (int repeat = 0; repeat < repeats; ++repeat) {
+			std::unique_ptr<BasicSynth2DSPKernel> kernel = BasicSynth2RegressionHarness::makeKernel(scenario);
+			kernel->flushDenormals = flushDenormals;
+			kernel->turnOffFinishedVoices = false;
+			std::vector<AURenderEvent> events = BasicSynth2RegressionHarness::sortedEvents(scenario);
+			size_t nextEvent = 0;
+
+			for (AUAudioFrameCount blockStart = 0; blockStart + blockSize <= scenario.frameCount; blockStart += blockSize) {
+				AURenderEvent const* head = BasicSynth2RegressionHarness::linkEvents(events, nextEvent, blockStart, blockStart + blockSize);
+				std::fill(left.begin(), left.end(), 0.0f);
+				std::fill(right.begin(), right.end(), 0.0f);
+
+				auto const start = std::chrono::steady_clock::now();
+				BasicSynth2RegressionHarness::renderSegment(*kernel, head, blockStart, blockSize, left.data(), right.data());
+				auto const end = std::chrono::steady_clock::now();
+
+				// Leave out the blocks with events in them; they log.
+				if (head != nullptr) {
+					continue;
+				}
+				int const phase = blockStart < noteOff ? 0 : blockStart < releaseEnd ? 1 : blockStart < decayEnd ? 2 : 3;
+				phases[phase].push_back(std::chrono::duration<double, std::nano>(end - start).count());
+			}
+		}
+
+		BasicSynth2TailProfile profile;
+		profile.sustain = median(phases[0]);
+		profile.release = median(phases[1]);
+		profile.decay = median(phases[2]);
+		profile.denormal = median(phases[3]);
+		return profile;
+	}
+
+	// Each phase's median over runs separate calls to run().
+	static BasicSynth2TailProfile medianOfRuns(bool flushDenormals, int runs = 5, AUAudioFrameCount blockSize = 256, double sampleRate = 44100.0) {
+		std::vector<double> phases[4];
+		for (int i = 0; i < runs; ++i) {
+			BasicSynth2TailProfile const profile = run(flushDenormals, blockSize, sampleRate);
+			phases[0].push_back(profile.sustain);
+			phases[1].push_back(profile.release);
+			phases[2].push_back(profile.decay);
+			phases[3].push_back(profile.denormal);
+		}
+
+		BasicSynth2TailProfile profile;
+		profile.sustain = median(phases[0]);
+		profile.release = median(phases[1]);
+		profile.decay = median(phases[2]);
+		profile.denormal = median(phases[3]);
+		return profile;
+	}
+
+	static void print(BasicSynth2TailProfile const& profile, bool flushDenormals) {
+		std::cout << "Render cost per block, flush to zero " << (flushDenormals ? "on" : "off") << std::endl;
+		std::cout << "	sustain  " << profile.sustain << " ns" << std::endl;
+		std::cout << "	release  " << profile.release << " ns (" << profile.release / profile.sustain << "x)" << std::endl;
+		std::cout << "	decay    " << profile.decay << " ns (" << profile.decay / profile.sustain << "x)" << std::endl;
+		std::cout << "	denormal " << profile.denormal << " ns (" << profile.denormal / profile.sustain << "x)" << std::endl;
+	}
+
+private:
+	static double median(std::vector<double> values) {
+		if (values.empty()) {
+			return 0;
+		}
+		std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+		return values[values.size() / 2];
+	}
+};
+
+#endif /* BasicSynth2TailBenchmark_hpp */
@@ -0,0 +1,23 @@
+//
+//  BasicSynth2Headers.cpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+// Every portable DSP header, so the regression target compiles the ones the runner doesn't use.
+// AUv3BufferedAudioBus.hpp and the adapter need AVFoundation and stay Xcode-only.
+
+#include "BasicSynth2DSPKernel.hpp"
+#include "BasicSynth2Denormals.hpp"
+#include "BasicSynth2Expression.hpp"
+#include "BasicSynth2KernelGroup.hpp"
+#include "BasicSynth2PresetSnapshot.hpp"
+#include "BasicSynth2SendEffects.hpp"
+#include "BasicSynth2Unison.hpp"
+#include "BasicSynth2Wavetable.hpp"
+
+#include "BasicSynth2NoteCache.hpp"
+#include "BasicSynth2RegressionHarness.hpp"
+#include "BasicSynth2RenderServer.hpp"
+#include "BasicSynth2TailBenchmark.hpp"
@@ -0,0 +1,96 @@
+//
+//  BasicSynth2Regression.cpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "BasicSynth2RegressionHarness.hpp"
+#include "BasicSynth2RenderServer.hpp"
+#include "BasicSynth2TailBenchmark.hpp"
+
+#ifndef BASICSYNTH2_REFERENCE_DIRECTORY
+#define BASICSYNTH2_REFERENCE_DIRECTORY "References"
+#endif
+
+// MARK: - BasicSynth2Regression
+/*
+ Command line runner for BasicSynth2RegressionHarness. Exits non-zero if any scenario fails.
+
+	--tolerance				compare within the harness's error and SNR limits instead of bit for bit
+	--record				write fresh references instead of comparing
+	--group					compare BasicSynth2KernelGroup's levels with the kernel's instead
+	--checks				run the harness's checks of individual pieces instead
+	--references <dir>		where the .bs2r files live (defaults to the References directory)
+	--render-server			time round trips through BasicSynth2RenderServer instead of running the scenarios
+	--tail-benchmark [runs]	time BasicSynth2TailBenchmark with flush to zero on and off, median of runs (5)
+ */
+
+static void printUsage(char const *name) {
+	std::cout << "usage: " << name << " [--tolerance] [--record] [--group] [--checks] [--references <directory>] [--render-server] [--tail-benchmark [runs]]" << std::endl;
+}
+
+int main(int argc, char **argv) {
+	BasicSynth2RegressionOptions options;
+	std::string directory = BASICSYNTH2_REFERENCE_DIRECTORY;
+	bool group = false;
+	bool checks = false;
+	bool renderServer = false;
+	int tailBenchmarkRuns = 0;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--tolerance") == 0) {
+			options.mode = BasicSynth2RegressionOptions::Tolerance;
+		} else if (strcmp(argv[i], "--record") == 0) {
+			options.record = true;
+		} else if (strcmp(argv[i], "--references") == 0 && i + 1 < argc) {
+			directory = argv[++i];
+		} else if (strcmp(argv[i], "--group") == 0) {
+			group = true;
+		} else if (strcmp(argv[i], "--checks") == 0) {
+			checks = true;
+		} else if (strcmp(argv[i], "--render-server") == 0) {
+			renderServer = true;
+		} else if (strcmp(argv[i], "--tail-benchmark") == 0) {
+			tailBenchmarkRuns = 5;
+			if (i + 1 < argc && atoi(argv[i + 1]) > 0) {
+				tailBenchmarkRuns = atoi(argv[++i]);
+			}
+		} else {
+			printUsage(argv[0]);
+			return 2;
+		}
+	}
+
+	if (renderServer) {
+		BasicSynth2RoundTripStatistics const statistics = BasicSynth2RenderServerBenchmark::run();
+		BasicSynth2RenderServerBenchmark::print(statistics);
+		return statistics.blocks > 0 && statistics.timeouts == 0 ? 0 : 1;
+	}
+
+	if (tailBenchmarkRuns > 0) {
+		for (bool flushDenormals : { true, false }) {
+			BasicSynth2TailProfile const profile = BasicSynth2TailBenchmark::medianOfRuns(flushDenormals, tailBenchmarkRuns);
+			BasicSynth2TailBenchmark::print(profile, flushDenormals);
+		}
+		return 0;
+	}
+
+	if (checks) {
+		bool const harnessPassed = BasicSynth2RegressionHarness::runChecks();
+		bool const serverPassed = BasicSynth2RenderServerBenchmark::runChecks();
+		return harnessPassed && serverPassed ? 0 : 1;
+	}
+
+	if (group) {
+		return BasicSynth2RegressionHarness::runGroupComparison(BasicSynth2RegressionHarness::defaultScenarios(), options) ? 0 : 1;
+	}
+
+	bool const passed = BasicSynth2RegressionHarness::run(directory, BasicSynth2RegressionHarness::defaultScenarios(), options);
+	return passed ? 0 : 1;
+}
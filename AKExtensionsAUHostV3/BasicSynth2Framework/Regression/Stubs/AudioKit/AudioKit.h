@@ -0,0 +1,172 @@
+//
+//  AudioKit.h
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+// MARK: - AudioKit stand-in
+/*
+ The parts of AudioKit that BasicSynth2DSPKernel uses: the Soundpipe structs and entry points it calls,
+ clamp(), pow2() and ParameterRamper. The struct layouts follow Soundpipe's so the kernel's field accesses
+ compile unchanged. The implementations in Soundpipe.cpp are stand-ins written for the regression target:
+ butlp and adsr follow Soundpipe's algorithms, blsquare is a naive pulse.
+
+ References recorded against these stand-ins pin down the kernel's own code, not AudioKit's.
+ */
+
+#ifndef BasicSynth2Stub_AudioKit_h
+#define BasicSynth2Stub_AudioKit_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <AudioToolbox/AudioToolbox.h>
+
+#define nil nullptr
+
+typedef float SPFLOAT;
+
+// MARK: - Soundpipe
+
+struct sp_data {
+	SPFLOAT *out;
+	int sr;
+	int nchan;
+	unsigned long len;
+	unsigned long pos;
+	char filename[200];
+	uint32_t rand;
+};
+
+struct sp_blsquare {
+	SPFLOAT *freq;
+	SPFLOAT *amp;
+	SPFLOAT *width;
+};
+
+struct sp_adsr {
+	SPFLOAT atk;
+	SPFLOAT dec;
+	SPFLOAT sus;
+	SPFLOAT rel;
+	uint32_t timer;
+	uint32_t atk_time;
+	SPFLOAT a;
+	SPFLOAT b;
+	SPFLOAT y;
+	SPFLOAT x;
+	SPFLOAT prev;
+	int mode;
+};
+
+struct sp_butlp {
+	SPFLOAT sr;
+	SPFLOAT freq;
+	SPFLOAT istor;
+	SPFLOAT lkf;
+	SPFLOAT a[8];
+	SPFLOAT pidsr;
+};
+
+int sp_create(sp_data **sp);
+int sp_destroy(sp_data **sp);
+
+int sp_blsquare_create(sp_blsquare **p);
+int sp_blsquare_destroy(sp_blsquare **p);
+int sp_blsquare_init(sp_data *sp, sp_blsquare *p);
+int sp_blsquare_compute(sp_data *sp, sp_blsquare *p, SPFLOAT *in, SPFLOAT *out);
+
+int sp_adsr_create(sp_adsr **p);
+int sp_adsr_destroy(sp_adsr **p);
+int sp_adsr_init(sp_data *sp, sp_adsr *p);
+int sp_adsr_compute(sp_data *sp, sp_adsr *p, SPFLOAT *in, SPFLOAT *out);
+
+int sp_butlp_create(sp_butlp **p);
+int sp_butlp_destroy(sp_butlp **p);
+int sp_butlp_init(sp_data *sp, sp_butlp *p);
+int sp_butlp_compute(sp_data *sp, sp_butlp *p, SPFLOAT *in, SPFLOAT *out);
+
+// MARK: - Helpers
+
+template <typename T>
+T clamp(T input, T low, T high) {
+	return std::min(std::max(input, low), high);
+}
+
+static inline double pow2(double x) {
+	return x * x;
+}
+
+// MARK: - ParameterRamper
+/*
+ Linear ramps stepped once per getAndStep(), with the UI value kept separately, like AudioKit's.
+ */
+struct ParameterRamper {
+	float value;
+	float goal;
+	float uiValue;
+	float increment = 0;
+	AUAudioFrameCount remaining = 0;
+
+	ParameterRamper(float initialValue) : value(initialValue), goal(initialValue), uiValue(initialValue) {}
+
+	void init() {}
+
+	void reset() {
+		remaining = 0;
+		value = goal;
+	}
+
+	void setImmediate(float newValue) {
+		value = goal = uiValue = newValue;
+		remaining = 0;
+	}
+
+	void setUIValue(float newValue) {
+		uiValue = newValue;
+		startRamp(newValue, 0);
+	}
+
+	float getUIValue() const { return uiValue; }
+
+	float get() const { return value; }
+
+	void step() {
+		if (remaining > 0) {
+			value += increment;
+			if (--remaining == 0) {
+				value = goal;
+			}
+		}
+	}
+
+	float getAndStep() {
+		float const current = value;
+		step();
+		return current;
+	}
+
+	void stepBy(AUAudioFrameCount frames) {
+		while (frames-- > 0 && remaining > 0) {
+			step();
+		}
+	}
+
+	void startRamp(float newGoal, AUAudioFrameCount duration) {
+		if (duration == 0) {
+			setImmediate(newGoal);
+			return;
+		}
+		goal = newGoal;
+		uiValue = newGoal;
+		increment = (newGoal - value) / (float)duration;
+		remaining = duration;
+	}
+};
+
+#endif /* BasicSynth2Stub_AudioKit_h */
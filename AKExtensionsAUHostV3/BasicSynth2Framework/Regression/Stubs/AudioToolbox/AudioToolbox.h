@@ -0,0 +1,98 @@
+//
+//  AudioToolbox.h
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+// MARK: - AudioToolbox stand-in
+/*
+ The handful of AudioToolbox types the BasicSynth2 DSP headers use, laid out like the real ones, so the
+ kernel can be built and run off Apple platforms by the regression target. Not a general replacement.
+ */
+
+#ifndef BasicSynth2Stub_AudioToolbox_h
+#define BasicSynth2Stub_AudioToolbox_h
+
+#include <cstdint>
+
+typedef uint8_t UInt8;
+typedef int32_t SInt32;
+typedef uint32_t UInt32;
+typedef uint64_t UInt64;
+typedef int32_t OSStatus;
+
+typedef uint32_t AUAudioFrameCount;
+typedef uint32_t AVAudioFrameCount;
+typedef uint64_t AUParameterAddress;
+typedef float AUValue;
+typedef int64_t AUEventSampleTime;
+typedef OSStatus AUAudioUnitStatus;
+
+enum { noErr = 0 };
+enum { kAudioTimeStampSampleTimeValid = 1 };
+
+struct AudioTimeStamp {
+	double mSampleTime;
+	UInt64 mHostTime;
+	double mRateScalar;
+	UInt64 mWordClockTime;
+	char mSMPTETime[24];
+	UInt32 mFlags;
+	UInt32 mReserved;
+};
+
+struct AudioBuffer {
+	UInt32 mNumberChannels;
+	UInt32 mDataByteSize;
+	void *mData;
+};
+
+struct AudioBufferList {
+	UInt32 mNumberBuffers;
+	AudioBuffer mBuffers[1];
+};
+
+enum AURenderEventType : uint8_t {
+	AURenderEventParameter = 1,
+	AURenderEventParameterRamp = 2,
+	AURenderEventMIDI = 8,
+	AURenderEventMIDISysEx = 9
+};
+
+union AURenderEvent;
+
+struct AURenderEventHeader {
+	AURenderEvent *next;
+	AUEventSampleTime eventSampleTime;
+	AURenderEventType eventType;
+	uint8_t reserved;
+};
+
+struct AUParameterEvent {
+	AURenderEvent *next;
+	AUEventSampleTime eventSampleTime;
+	AURenderEventType eventType;
+	uint8_t reserved[3];
+	AUAudioFrameCount rampDurationSampleFrames;
+	AUParameterAddress parameterAddress;
+	AUValue value;
+};
+
+struct AUMIDIEvent {
+	AURenderEvent *next;
+	AUEventSampleTime eventSampleTime;
+	AURenderEventType eventType;
+	uint8_t reserved;
+	uint16_t length;
+	uint8_t cable;
+	uint8_t data[3];
+};
+
+union AURenderEvent {
+	AURenderEventHeader head;
+	AUParameterEvent parameter;
+	AUMIDIEvent MIDI;
+};
+
+#endif /* BasicSynth2Stub_AudioToolbox_h */
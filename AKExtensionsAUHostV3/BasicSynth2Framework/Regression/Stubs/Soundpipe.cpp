@@ -0,0 +1,212 @@
+//
+//  Soundpipe.cpp
+//  BasicSynth2
+//
+//  Copyright © 2020 Apple. All rights reserved.
+//
+
+#include <AudioKit/AudioKit.h>
+
+// MARK: - sp_data
+
+int sp_create(sp_data **sp) {
+	*sp = (sp_data *)calloc(1, sizeof(sp_data));
+	(*sp)->sr = 44100;
+	(*sp)->nchan = 1;
+	return 0;
+}
+
+int sp_destroy(sp_data **sp) {
+	free(*sp);
+	*sp = nullptr;
+	return 0;
+}
+
+// MARK: - sp_blsquare
+/*
+ A naive pulse at amp, switching at width. Soundpipe's is band-limited; the kernel only sets its
+ parameters and reads samples, which is all the stand-in needs to support.
+ */
+
+namespace {
+	struct BlsquareState {
+		sp_blsquare parameters;
+		SPFLOAT freq;
+		SPFLOAT amp;
+		SPFLOAT width;
+		double phase;
+	};
+}
+
+int sp_blsquare_create(sp_blsquare **p) {
+	BlsquareState *state = (BlsquareState *)calloc(1, sizeof(BlsquareState));
+	state->parameters.freq = &state->freq;
+	state->parameters.amp = &state->amp;
+	state->parameters.width = &state->width;
+	state->freq = 440;
+	state->amp = 0.5;
+	state->width = 0.5;
+	*p = &state->parameters;
+	return 0;
+}
+
+int sp_blsquare_destroy(sp_blsquare **p) {
+	free(*p);
+	*p = nullptr;
+	return 0;
+}
+
+int sp_blsquare_init(sp_data *, sp_blsquare *p) {
+	((BlsquareState *)p)->phase = 0;
+	return 0;
+}
+
+int sp_blsquare_compute(sp_data *sp, sp_blsquare *p, SPFLOAT *, SPFLOAT *out) {
+	BlsquareState *state = (BlsquareState *)p;
+	*out = (state->phase < state->width ? 1.0f : -1.0f) * state->amp;
+	state->phase += state->freq / sp->sr;
+	if (state->phase >= 1.0) {
+		state->phase -= 1.0;
+	}
+	return 0;
+}
+
+// MARK: - sp_adsr
+/*
+ Soundpipe's gate-edge-triggered ADSR: a rising gate starts the attack (one-pole towards the gate),
+ a falling gate starts the release, and the level in between is a one-pole decay towards sus.
+ */
+
+namespace {
+	enum { AdsrClear, AdsrAttack, AdsrDecay, AdsrRelease };
+
+	SPFLOAT tau2pole(sp_data *sp, SPFLOAT tau) {
+		return (SPFLOAT)exp(-1.0 / (tau * sp->sr));
+	}
+
+	SPFLOAT adsrFilter(sp_adsr *p) {
+		p->y = p->b * p->x + p->a * p->y;
+		return p->y;
+	}
+}
+
+int sp_adsr_create(sp_adsr **p) {
+	*p = (sp_adsr *)calloc(1, sizeof(sp_adsr));
+	return 0;
+}
+
+int sp_adsr_destroy(sp_adsr **p) {
+	free(*p);
+	*p = nullptr;
+	return 0;
+}
+
+int sp_adsr_init(sp_data *sp, sp_adsr *p) {
+	p->atk = 0.1f;
+	p->dec = 0.1f;
+	p->sus = 0.5f;
+	p->rel = 0.3f;
+	p->timer = 0;
+	p->a = 0;
+	p->b = 0;
+	p->y = 0;
+	p->x = 0;
+	p->prev = 0;
+	p->atk_time = (uint32_t)(p->atk * sp->sr);
+	p->mode = AdsrClear;
+	return 0;
+}
+
+int sp_adsr_compute(sp_data *sp, sp_adsr *p, SPFLOAT *in, SPFLOAT *out) {
+	if (p->prev < *in && p->mode != AdsrDecay) {
+		p->mode = AdsrAttack;
+		p->timer = 0;
+		SPFLOAT const pole = tau2pole(sp, p->atk * 0.75f);
+		p->atk_time = (uint32_t)(p->atk * sp->sr * 1.5f);
+		p->a = pole;
+		p->b = 1 - pole;
+	} else if (p->prev > *in) {
+		p->mode = AdsrRelease;
+		SPFLOAT const pole = tau2pole(sp, p->rel);
+		p->a = pole;
+		p->b = 1 - pole;
+	}
+
+	p->x = *in;
+	p->prev = *in;
+
+	switch (p->mode) {
+		case AdsrClear:
+			*out = 0;
+			break;
+		case AdsrAttack:
+			p->timer++;
+			*out = adsrFilter(p);
+			if (*out > 0.99f || p->timer > p->atk_time) {
+				p->mode = AdsrDecay;
+				SPFLOAT const pole = tau2pole(sp, p->dec);
+				p->a = pole;
+				p->b = 1 - pole;
+			}
+			break;
+		case AdsrDecay:
+		case AdsrRelease:
+			p->x *= p->sus;
+			*out = adsrFilter(p);
+			break;
+		default:
+			break;
+	}
+	return 0;
+}
+
+// MARK: - sp_butlp
+/*
+ Soundpipe's second order Butterworth lowpass, coefficients recomputed whenever freq changes.
+ */
+
+int sp_butlp_create(sp_butlp **p) {
+	*p = (sp_butlp *)calloc(1, sizeof(sp_butlp));
+	return 0;
+}
+
+int sp_butlp_destroy(sp_butlp **p) {
+	free(*p);
+	*p = nullptr;
+	return 0;
+}
+
+int sp_butlp_init(sp_data *sp, sp_butlp *p) {
+	p->istor = 0;
+	p->sr = (SPFLOAT)sp->sr;
+	p->freq = 1000;
+	p->pidsr = (SPFLOAT)(M_PI / sp->sr);
+	p->a[6] = 0;
+	p->a[7] = 0;
+	p->lkf = 0;
+	return 0;
+}
+
+int sp_butlp_compute(sp_data *, sp_butlp *p, SPFLOAT *in, SPFLOAT *out) {
+	if (p->freq <= 0) {
+		*out = 0;
+		return 0;
+	}
+
+	SPFLOAT *a = p->a;
+	if (p->freq != p->lkf) {
+		p->lkf = p->freq;
+		SPFLOAT const c = 1.0f / tanf(p->pidsr * p->lkf);
+		a[1] = 1.0f / (1.0f + (SPFLOAT)M_SQRT2 * c + c * c);
+		a[2] = a[1] + a[1];
+		a[3] = a[1];
+		a[4] = 2.0f * (1.0f - c * c) * a[1];
+		a[5] = (1.0f - (SPFLOAT)M_SQRT2 * c + c * c) * a[1];
+	}
+
+	SPFLOAT const t = *in - a[4] * a[6] - a[5] * a[7];
+	*out = t * a[1] + a[2] * a[6] + a[3] * a[7];
+	a[7] = a[6];
+	a[6] = t;
+	return 0;
+}